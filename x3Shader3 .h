@@ -4,6 +4,8 @@
 #define SHADER_H
 
 #include <glad/glad.h> //include glad to get all the required OpenGL headers
+#include "UniformTable.h"
+#include "ProgramCache.h"
 
 #include <string>
 #include <iostream>
@@ -13,6 +15,7 @@ class Shader
 {
 public:
 	unsigned int ID; //the shader program ID
+	UniformTable uniforms; //name -> location of the active uniforms
 
 	//constructor reads and builds the shader
 	Shader() {
@@ -35,28 +38,33 @@ public:
 			"void main() {"
 			"	FragColor = vec4(myColor, 1.0); }\0";
 
-		//☆2. compile shaders
-		unsigned int vertexShader, fragmentShader;
-
-		//vertex Shader
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
-		glCompileShader(vertexShader);
-		checkCompileError(vertexShader, "VERTEX");
-		//fragment Shader
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		checkCompileError(fragmentShader, "FRAGMENT");
+		//a cached binary of the same sources skips the compile and link (see ProgramCache.h)
+		ID = ProgramCache::instance().load(vertexShaderCode, fragmentShaderCode);
+		if (!ID) {
+			//☆2. compile shaders
+			unsigned int vertexShader, fragmentShader;
+
+			//vertex Shader
+			vertexShader = glCreateShader(GL_VERTEX_SHADER);
+			glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+			glCompileShader(vertexShader);
+			checkCompileError(vertexShader, "VERTEX");
+			//fragment Shader
+			fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+			glCompileShader(fragmentShader);
+			checkCompileError(fragmentShader, "FRAGMENT");
 		
-		//shader Program 
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		//delete the shader as they're linked into our program now and no longer necessary
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+			//shader Program 
+			ID = glCreateProgram();
+			glAttachShader(ID, vertexShader);
+			glAttachShader(ID, fragmentShader);
+			ProgramCache::instance().link(ID, vertexShaderCode, fragmentShaderCode); //links, and keeps the binary for the next launch
+			//delete the shader as they're linked into our program now and no longer necessary
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+		}
+		uniforms.build(ID); //reflect the active uniforms once, the setters look them up here
 	}
 
 	//use/activate the shader
@@ -67,13 +75,29 @@ public:
 	//utility uniform functions 
 	//check a uniform location and set its value
 	void setBool(const std::string &name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(uniforms.find(name), (int)value);
 	}
 	void setInt(const std::string &name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(uniforms.find(name), value);
 	}
 	void setFloat(const std::string &name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(uniforms.find(name), value);
+	}
+
+	//resolve a uniform once (e.g. before a render loop) and pass the handle to the setters below
+	UniformHandle uniform(const std::string& name) const {
+		UniformHandle handle;
+		handle.location = uniforms.find(name);
+		return handle;
+	}
+	void setBool(UniformHandle uniform, bool value) const {
+		glUniform1i(uniform.location, (int)value);
+	}
+	void setInt(UniformHandle uniform, int value) const {
+		glUniform1i(uniform.location, value);
+	}
+	void setFloat(UniformHandle uniform, float value) const {
+		glUniform1f(uniform.location, value);
 	}
 
 
@@ -44,25 +44,30 @@ NDC:(each vertex's x,y,z should be between -1.0~1.0)--coordinates ourside this r
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "UniformTable.h"
+#include "ProgramCache.h"
 #include <iostream>
 
 class Shader
 {
 public:
 	unsigned int ID;
+	UniformTable uniforms; //name -> location of the active uniforms
 
 	Shader() {
 const char* vertexShaderCode = "#version 410 core\n"
 			"layout (location = 0) in vec3 aPos;\n"
 			"layout (location = 1) in vec2 aTexCoord;\n"
+			"layout (location = 3) in mat4 aInstanceModel;\n" //per-instance model matrix (InstanceBuffer)
 			"out vec2 TexCoord;\n"
 			"uniform mat4 model;"
 			"uniform mat4 view;"
 			"uniform mat4 projection;"
+			"uniform bool instanced;" //true: draw with glDrawArraysInstanced, the model matrix comes from aInstanceModel
 			"void main(){"
 			//clip V = projection M · view M · model M · object V
 			/*Remever that the order of matrix multiplication is reversed(we need to read matrix multiplication from right to left. ←)*/
-			"	gl_Position = projection * view * model * vec4(aPos, 1.0);"
+			"	gl_Position = projection * view * (instanced ? aInstanceModel : model) * vec4(aPos, 1.0);"
 			"	TexCoord = vec2(aTexCoord.x, aTexCoord.y);}\0"; 
 		const char* fragmentShaderCode = "#version 410 core\n"
 			"out vec4 FragColor;\n"
@@ -71,27 +76,32 @@ const char* vertexShaderCode = "#version 410 core\n"
 			"uniform sampler2D texture2;"
 			"void main() {"
 			"	FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.3); }\0";
-		//☆2. compile shaders
-		unsigned int vertexShader, fragmentShader;
-
-		//vertex Shader
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
-		glCompileShader(vertexShader);
-		checkCompileError(vertexShader, "VERTEX");
-		//fragment Shader
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		checkCompileError(fragmentShader, "FRAGMENT");
-
-		//shader Program 
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+		//a cached binary of the same sources skips the compile and link (see ProgramCache.h)
+		ID = ProgramCache::instance().load(vertexShaderCode, fragmentShaderCode);
+		if (!ID) {
+			//☆2. compile shaders
+			unsigned int vertexShader, fragmentShader;
+
+			//vertex Shader
+			vertexShader = glCreateShader(GL_VERTEX_SHADER);
+			glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+			glCompileShader(vertexShader);
+			checkCompileError(vertexShader, "VERTEX");
+			//fragment Shader
+			fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+			glCompileShader(fragmentShader);
+			checkCompileError(fragmentShader, "FRAGMENT");
+
+			//shader Program 
+			ID = glCreateProgram();
+			glAttachShader(ID, vertexShader);
+			glAttachShader(ID, fragmentShader);
+			ProgramCache::instance().link(ID, vertexShaderCode, fragmentShaderCode); //links, and keeps the binary for the next launch
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+		}
+		uniforms.build(ID); //reflect the active uniforms once, the setters look them up here
 	}
 
 	//use/activate the shader
@@ -101,13 +111,29 @@ const char* vertexShaderCode = "#version 410 core\n"
 	}
 
 	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(uniforms.find(name), (int)value);
 	}
 	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(uniforms.find(name), value);
 	}
 	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(uniforms.find(name), value);
+	}
+
+	//resolve a uniform once (e.g. before a render loop) and pass the handle to the setters below
+	UniformHandle uniform(const std::string& name) const {
+		UniformHandle handle;
+		handle.location = uniforms.find(name);
+		return handle;
+	}
+	void setBool(UniformHandle uniform, bool value) const {
+		glUniform1i(uniform.location, (int)value);
+	}
+	void setInt(UniformHandle uniform, int value) const {
+		glUniform1i(uniform.location, value);
+	}
+	void setFloat(UniformHandle uniform, float value) const {
+		glUniform1f(uniform.location, value);
 	}
 
 
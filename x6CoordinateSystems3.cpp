@@ -26,6 +26,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "Shader.h"
+#include "InstanceBuffer.h"
 #include <iostream>
 #include <cmath>
 #include <glad/glad.h>
@@ -34,6 +35,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+//true: the cube field is one glDrawArraysInstanced, false: one model uniform + glDrawArrays per cube
+const bool INSTANCED_CUBES = true;
+
 void Esc(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
 }
@@ -156,6 +160,9 @@ int main() {
 	// texture coord attribute
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+	// per-instance model matrix attribute (re-uploaded every frame, the cubes rotate)
+	InstanceBuffer cubeInstances;
+	cubeInstances.attach();
 
 
 
@@ -210,6 +217,7 @@ int main() {
 	myShader.use();
 	myShader.setInt("texture1", 0);
 	myShader.setInt("texture2", 1);
+	myShader.setBool("instanced", INSTANCED_CUBES);
 
 
 	//render loop
@@ -269,6 +277,7 @@ int main() {
 
 
 		glBindVertexArray(VAO);
+		glm::mat4 cubeTransforms[10];
 		for (unsigned int i = 0; i < 10; i++) {
 			glm::mat4 model = glm::mat4(1.0f);
 			model = glm::translate(model, cubePositions[i]);
@@ -278,10 +287,18 @@ int main() {
 				angle = (float)glfwGetTime() * 20.0f;
 			}
 			model = glm::rotate(model, glm::radians(angle), glm::vec3(.7f + i / angle * 20, angle / 20 * 0.3f - 0.5f, 0.5f + i / 10));
+			if (INSTANCED_CUBES) {
+				cubeTransforms[i] = model;
+				continue;
+			}
 			unsigned int modelLocation = glGetUniformLocation(myShader.ID, "model");
 			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
 			glDrawArrays(GL_TRIANGLES, 0, 36);
 		}
+		if (INSTANCED_CUBES) {
+			cubeInstances.upload(cubeTransforms, 10);
+			cubeInstances.draw(GL_TRIANGLES, 0, 36);
+		}
 		/////////////////////////////////////////////////////////////
 
 
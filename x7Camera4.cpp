@@ -1,6 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "Shader.h"
+#include "InstanceBuffer.h"
 #include "Camera.h"
 #include <iostream>
 #include <cmath>
@@ -10,6 +11,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+//true: the cube field is one glDrawArraysInstanced, false: one model uniform + glDrawArrays per cube
+const bool INSTANCED_CUBES = true;
+
 //camera
 Camera camera(glm::vec3(.0f, .0f, 3.0f));
 float lastX = 1600.0f / 2.0f;
@@ -179,6 +183,9 @@ int main() {
 	// texture coord attribute
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(1);
+	// per-instance model matrix attribute (re-uploaded every frame, the cubes rotate)
+	InstanceBuffer cubeInstances;
+	cubeInstances.attach();
 
 	
 	
@@ -238,6 +245,7 @@ int main() {
 	myShader.use();
 	myShader.setInt("texture1", 0);
 	myShader.setInt("texture2", 1);
+	myShader.setBool("instanced", INSTANCED_CUBES);
 
 	//render loop
 	while (!glfwWindowShouldClose(window))
@@ -287,6 +295,7 @@ int main() {
 		myShader.setMat4("view", view);
 
 		glBindVertexArray(VAO);
+		glm::mat4 cubeTransforms[10];
 		for (unsigned int i = 0; i < 10; i++) {
 			glm::mat4 model = glm::mat4(1.0f);
 			model = glm::translate(model, cubePositions[i]);
@@ -295,10 +304,18 @@ int main() {
 				model = glm::rotate(model, glm::radians(angle), glm::vec3(.7f + i / angle * 20, angle / 20 * 0.3f - 0.5f, 0.5f + i / 10));
 			}
 			model = glm::rotate(model, glm::radians(angle), glm::vec3(.7f + i, 0.3f - 0.5f, 0.5f + i));
+			if (INSTANCED_CUBES) {
+				cubeTransforms[i] = model;
+				continue;
+			}
 			unsigned int modelLocation = glGetUniformLocation(myShader.ID, "model");
 			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
 			glDrawArrays(GL_TRIANGLES, 0, 36);
 		}
+		if (INSTANCED_CUBES) {
+			cubeInstances.upload(cubeTransforms, 10);
+			cubeInstances.draw(GL_TRIANGLES, 0, 36);
+		}
 
 		//glfw : swap buffer and poll event (key pressed/release, mouse moved etc..)
 		glfwSwapBuffers(window);
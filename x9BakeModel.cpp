@@ -0,0 +1,65 @@
+//Offline tool: load a model through ASSIMP once and write it as a .xmdl file that Model can memory map.
+//usage: BakeModel [--optimize] [--lods] <model path> [output path]   (default output: model path with .xmdl extension)
+//  --optimize: bake the meshes in vertex cache/overdraw/fetch optimized order (see MeshOptimizer.h)
+//  --lods: bake a level of detail chain per mesh (see MeshSimplifier.h)
+//The output must stay next to the source model, texture paths are stored relative to it.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <string>
+
+#include "Shader.h"
+#include "Model.h"
+
+int main(int argc, char** argv)
+{
+	bool optimize = false, lods = false;
+	int first = 1;
+	for (; first < argc && argv[first][0] == '-' && argv[first][1] == '-'; first++) {
+		if (std::string(argv[first]) == "--optimize") optimize = true;
+		else if (std::string(argv[first]) == "--lods") lods = true;
+	}
+	if (argc <= first) {
+		std::cout << "usage: BakeModel [--optimize] [--lods] <model path> [output path]" << std::endl;
+		return -1;
+	}
+	std::string input = argv[first];
+	std::string output = argc > first + 1 ? argv[first + 1] : input.substr(0, input.find_last_of('.')) + ".xmdl";
+
+	//glfw: a hidden window, Model creates GL buffers while loading
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "BakeModel", NULL, NULL);
+	if (window == NULL) {
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	int result = -1;
+	{
+		ModelOptions options;
+		options.optimize = optimize;
+		options.lods = lods;
+		Model model(input, options);
+		if (model.meshes.empty()) std::cout << "nothing to bake in " << input << std::endl;
+		else if (writeBakedModel(output, model.meshes, &model.nodes)) {
+			std::cout << "baked " << model.meshes.size() << " meshes of " << input << " into " << output << std::endl;
+			result = 0;
+		}
+	}
+
+	glfwTerminate();
+	return result;
+}
@@ -0,0 +1,91 @@
+//Offline tool: compress an image into a .ktx2 file with its whole mip chain (see BlockCompression.h, KTX2.h).
+//usage: BakeTexture [--bc1|--bc3|--bc5|--bc7|--etc2] [--srgb] [--normal] [--box] [--flip] [--no-mips] <image path> [output path]
+//  format: default BC7 for images with alpha, BC1 without. --bc5 keeps red + green only (normal maps)
+//  --srgb: the image is sRGB encoded (albedo/diffuse maps): the mips are averaged in linear space, the file is marked SRGB
+//  --flip: store the rows bottom to top, for loaders that flip (TextureCache::setFlipVertically(true))
+//  --normal: a normal map, the mips are renormalized
+//  --box: box filtered mips (default Kaiser, see MipGenerator.h)
+//  --no-mips: level 0 only
+//default output: the image path with .ktx2 extension, where the texture loaders look for it (textureLoadOptions().preferKTX2)
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "KTX2.h"
+#include "MipGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+int main(int argc, char** argv)
+{
+	int format = -1;
+	bool srgb = false, normal = false, flip = false, mips = true;
+	Mip_Filter filter = MIP_KAISER;
+	int first = 1;
+	for (; first < argc && argv[first][0] == '-' && argv[first][1] == '-'; first++) {
+		std::string option = argv[first];
+		if (option == "--bc1") format = BLOCK_BC1;
+		else if (option == "--bc3") format = BLOCK_BC3;
+		else if (option == "--bc5") format = BLOCK_BC5;
+		else if (option == "--bc7") format = BLOCK_BC7;
+		else if (option == "--etc2") format = BLOCK_ETC2;
+		else if (option == "--srgb") srgb = true;
+		else if (option == "--normal") normal = true;
+		else if (option == "--box") filter = MIP_BOX;
+		else if (option == "--flip") flip = true;
+		else if (option == "--no-mips") mips = false;
+	}
+	if (argc <= first) {
+		std::cout << "usage: BakeTexture [--bc1|--bc3|--bc5|--bc7|--etc2] [--srgb] [--normal] [--box] [--flip] [--no-mips] <image path> [output path]" << std::endl;
+		return -1;
+	}
+	std::string input = argv[first];
+	std::string output = argc > first + 1 ? argv[first + 1] : input.substr(0, input.find_last_of('.')) + ".ktx2";
+
+	auto start = std::chrono::steady_clock::now();
+	stbi_set_flip_vertically_on_load(flip);
+	int width, height, components;
+	unsigned char* pixels = stbi_load(input.c_str(), &width, &height, &components, 4); //(always RGBA8)
+	if (!pixels) {
+		std::cout << "cannot read " << input << std::endl;
+		return -1;
+	}
+	if (format < 0) format = components == 4 || components == 2 ? BLOCK_BC7 : BLOCK_BC1;
+
+	KTX2Image image;
+	image.format = (Block_Format)format;
+	image.srgb = srgb && !normal && image.format != BLOCK_BC5;
+	image.flipped = flip;
+	image.source = input.substr(input.find_last_of("/\\") + 1); //(the loaders only take a sibling .ktx2 baked from the same file)
+	image.width = width;
+	image.height = height;
+	//levels 1..n, filtered from the RGBA8 image on every hardware thread
+	std::vector<std::vector<unsigned char>> chain;
+	if (mips) generateMips(pixels, width, height, 4, filter, (image.srgb ? MIP_SRGB : 0) | (normal ? MIP_NORMAL_MAP : 0), chain,
+		std::max(std::thread::hardware_concurrency(), 1u));
+
+	int levelCount = (int)chain.size() + 1;
+	size_t uncompressedBytes = 0;
+	for (int i = 0; i < levelCount; i++) {
+		const unsigned char* level = i == 0 ? pixels : chain[i - 1].data();
+		image.levels.push_back(std::vector<unsigned char>(compressedSize(image.format, width, height)));
+		compressImage(image.format, level, width, height, image.levels.back().data());
+		uncompressedBytes += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	stbi_image_free(pixels);
+	if (!writeKTX2(output, image)) return -1;
+
+	static const char* names[] = { "BC1", "BC3", "BC5", "BC7", "ETC2" };
+	size_t compressedBytes = 0;
+	for (size_t i = 0; i < image.levels.size(); i++) compressedBytes += image.levels[i].size();
+	std::cout << "baked " << input << " (" << image.width << "x" << image.height << ", " << levelCount << " levels) into " << output
+		<< ": " << names[format] << (image.srgb ? " sRGB" : "") << ", " << compressedBytes << " bytes (RGBA8: " << uncompressedBytes << " bytes), "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+	return 0;
+}
@@ -0,0 +1,994 @@
+//Benchmarks for the loading/rendering paths of the model viewer.
+//usage: Benchmark <mode> [args]
+//  textures [model path]  : Model load time with serial vs worker-thread texture decoding
+//  bake <model> <xmdl>    : startup time of the ASSIMP import vs the memory mapped baked file (see BakeModel)
+//  draw [model path]      : draw calls and CPU submission time of Model::Draw per mesh vs batched by material
+//  allocations [model]    : check that Model::Draw does no heap allocation after its first frame (exit code 1 if it does)
+//  cubes [count]          : cube field (default 100000) drawn one glDrawArrays per cube vs one glDrawArraysInstanced
+//  stream [count]         : moving cube field (default 10000): model matrices by glUniformMatrix4fv vs StreamBuffer ranges,
+//                           instance matrices by orphaning upload vs StreamBuffer, with the fence waits of the stream buffer
+//  vertexformat [model]   : vertex buffer size and vertex fetch bandwidth of the full vs the packed vertex layout
+//  lods [model]           : LOD chain build time, and triangles/draw time per frame with the model at growing distances
+//  cull [count]           : frustum culling kernels (default 100000 bounds), scalar vs SSE, spheres and boxes (CPU only)
+//  nodes [count]          : scene graph world matrix update (default 100000 nodes), everything vs 1% of the subtrees dirty (CPU only)
+//  shaders [count]        : Shader construction with an empty program binary cache (cold start) vs a filled one (warm start),
+//                           and count (default 8) different programs compiled one after another vs submitted together (ProgramBuilder)
+//  ktx2 [image] [ktx2]    : load time and VRAM of a png/jpg (stb_image + mips) vs its BakeTexture .ktx2
+//                           (default container2.png and the .ktx2 next to it), compressed upload and CPU decode fallback
+//  mips [image]           : mip chain of an image (default container2.png): glGenerateMipmap vs MipGenerator in MB/s,
+//                           box/Kaiser, scalar/SIMD, one thread/every hardware thread
+//  streaming [model] [MB] : time to the first drawable frame of a Model with its textures loaded up front vs streamed
+//                           (TextureStreamer.h), and the frames/worst update() it takes to stream them at MB per frame (default 4)
+//  async [model] [count]  : count (default 4) copies of a model loaded by the blocking constructor vs through a ModelLoader
+//                           while frames keep running: time until all are drawable, longest GL thread stall / frame
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+#include "Shader.h"
+#include "Model.h"
+#include "InstanceBuffer.h"
+#include "RenderContext.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "StreamBuffer.h"
+#include "UniformBlock.h"
+#include "TextureStreamer.h"
+#include "ModelLoader.h"
+#include "MipGenerator.h"
+
+//setting
+const unsigned int SCR_WIDTH = 1600;
+const unsigned int SCR_HEIGHT = 1200;
+
+//heap allocation counter: every operator new of the program goes through here
+std::atomic<size_t> allocationCount(0);
+void* operator new(size_t size) {
+	allocationCount++;
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+//milliseconds since start
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
+
+
+//load the same model with the serial TextureFromFile path and with the decode pool.
+//the rounds alternate so both paths see the same (warm) OS file cache.
+int benchTextures(const std::string& path) {
+	const int rounds = 3;
+	double bestSerial = 1e30, bestParallel = 1e30;
+
+	for (int round = 0; round < rounds; round++) {
+		for (int parallel = 0; parallel < 2; parallel++) {
+			ModelOptions options;
+			options.parallelTextures = parallel == 1;
+			auto start = std::chrono::steady_clock::now();
+			Model model(path, options);
+			glFinish(); //include the driver's upload work
+			double ms = millisecondsSince(start);
+
+			std::cout << (parallel ? "parallel" : "serial  ") << " round " << round << ": " << ms << " ms ("
+				<< model.meshes.size() << " meshes, " << model.textures_loaded.size() << " textures)" << std::endl;
+			if (parallel) bestParallel = std::min(bestParallel, ms);
+			else bestSerial = std::min(bestSerial, ms);
+		}
+	}
+
+	std::cout << "best serial: " << bestSerial << " ms, best parallel: " << bestParallel << " ms ("
+		<< TextureDecodePool::defaultThreadCount() << " decode threads), speedup x" << bestSerial / bestParallel << std::endl;
+	return 0;
+}
+
+
+
+
+
+
+
+//startup: source model through ASSIMP vs the baked .xmdl.
+//a Model kept alive for the whole run holds the textures in the TextureCache, so both timings measure geometry only.
+int benchBake(const std::string& source, const std::string& baked) {
+	Model textureHolder(source);
+	const int rounds = 3;
+	double bestSource = 1e30, bestBaked = 1e30;
+
+	for (int round = 0; round < rounds; round++) {
+		auto start = std::chrono::steady_clock::now();
+		{
+			Model model(source);
+			glFinish();
+		}
+		double sourceMs = millisecondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		size_t bakedMeshes;
+		{
+			Model model(baked);
+			glFinish();
+			bakedMeshes = model.meshes.size();
+		}
+		double bakedMs = millisecondsSince(start);
+		if (bakedMeshes != textureHolder.meshes.size()) {
+			std::cout << "baked file has " << bakedMeshes << " meshes, source has " << textureHolder.meshes.size() << " (re-bake it)" << std::endl;
+			return -1;
+		}
+
+		std::cout << "round " << round << ": assimp " << sourceMs << " ms, baked " << bakedMs << " ms" << std::endl;
+		bestSource = std::min(bestSource, sourceMs);
+		bestBaked = std::min(bestBaked, bakedMs);
+	}
+
+	std::cout << "best assimp: " << bestSource << " ms, best baked: " << bestBaked << " ms, speedup x" << bestSource / bestBaked << std::endl;
+	return 0;
+}
+
+
+
+//CPU cost of submitting the model: the time to issue the calls (without glFinish) and the time until the GPU is done
+int benchDraw(const std::string& path) {
+	const int frames = 500;
+	Shader shader;
+	Model model(path);
+	shader.use();
+	shader.setMat4("projection", glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 100.0f));
+	shader.setMat4("view", glm::lookAt(glm::vec3(.0f, .0f, 3.0f), glm::vec3(.0f), glm::vec3(.0f, 1.0f, .0f)));
+	shader.setMat4("model", glm::mat4(1.0f));
+
+	const Model_DrawMode modes[] = { DRAW_PER_MESH, DRAW_BATCHED };
+	const char* names[] = { "per mesh", "batched " };
+	for (int m = 0; m < 2; m++) {
+		model.drawMode = modes[m];
+		model.Draw(shader); //warm up (builds the batches)
+		glFinish();
+
+		double submitMs = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			auto submit = std::chrono::steady_clock::now();
+			model.Draw(shader);
+			submitMs += millisecondsSince(submit);
+		}
+		glFinish();
+		double totalMs = millisecondsSince(start);
+
+		std::cout << names[m] << ": " << model.drawCalls << " draw calls/frame, submit " << submitMs / frames << " ms/frame, "
+			<< "total " << totalMs / frames << " ms/frame" << std::endl;
+	}
+	return 0;
+}
+
+
+//the per-frame draw must not allocate: the first Draw() may (sampler locations, batches), every further one may not
+int benchAllocations(const std::string& path) {
+	const int frames = 100;
+	Shader shader;
+	Model model(path);
+	shader.use();
+
+	bool failed = false;
+	const Model_DrawMode modes[] = { DRAW_PER_MESH, DRAW_BATCHED };
+	const char* names[] = { "per mesh", "batched " };
+	for (int m = 0; m < 2; m++) {
+		model.drawMode = modes[m];
+		model.Draw(shader);
+
+		size_t before = allocationCount;
+		for (int frame = 0; frame < frames; frame++) model.Draw(shader);
+		size_t allocations = allocationCount - before;
+
+		std::cout << names[m] << ": " << allocations << " heap allocations in " << frames << " frames" << (allocations ? "  <-- FAILED" : "") << std::endl;
+		if (allocations) failed = true;
+	}
+	return failed ? 1 : 0;
+}
+
+
+
+
+//unit cube, positions only
+const float CUBE_POSITIONS[] = {
+	-.5f,-.5f,-.5f,  .5f,-.5f,-.5f,  .5f, .5f,-.5f,  .5f, .5f,-.5f, -.5f, .5f,-.5f, -.5f,-.5f,-.5f,
+	-.5f,-.5f, .5f,  .5f,-.5f, .5f,  .5f, .5f, .5f,  .5f, .5f, .5f, -.5f, .5f, .5f, -.5f,-.5f, .5f,
+	-.5f, .5f, .5f, -.5f, .5f,-.5f, -.5f,-.5f,-.5f, -.5f,-.5f,-.5f, -.5f,-.5f, .5f, -.5f, .5f, .5f,
+	 .5f, .5f, .5f,  .5f, .5f,-.5f,  .5f,-.5f,-.5f,  .5f,-.5f,-.5f,  .5f,-.5f, .5f,  .5f, .5f, .5f,
+	-.5f,-.5f,-.5f,  .5f,-.5f,-.5f,  .5f,-.5f, .5f,  .5f,-.5f, .5f, -.5f,-.5f, .5f, -.5f,-.5f,-.5f,
+	-.5f, .5f,-.5f,  .5f, .5f,-.5f,  .5f, .5f, .5f,  .5f, .5f, .5f, -.5f, .5f, .5f, -.5f, .5f,-.5f
+};
+
+//a position-only program for the cube field, with all the ways of getting the model matrix
+unsigned int cubeFieldProgram() {
+	const char* vertexShaderCode = "#version 410 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 3) in mat4 aInstanceModel;\n"
+		"uniform mat4 model;"
+		"layout (std140) uniform Object { mat4 objectModel; };"
+		"uniform mat4 viewProjection;"
+		"uniform bool instanced;"
+		"uniform bool streamed;" //per object: the model matrix comes from the Object block
+		"void main(){ gl_Position = viewProjection * (instanced ? aInstanceModel : streamed ? objectModel : model) * vec4(aPos, 1.0); }";
+	const char* fragmentShaderCode = "#version 410 core\n"
+		"out vec4 FragColor;"
+		"void main(){ FragColor = vec4(1.0, 0.5, 0.2, 1.0); }";
+
+	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+	glCompileShader(vertexShader);
+	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+	glCompileShader(fragmentShader);
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	return program;
+}
+
+//the same cube field drawn per object (uniform + glDrawArrays per cube) and instanced (one draw call).
+//"instanced + upload" re-uploads all matrices every frame, like a field where everything moves.
+int benchCubes(unsigned int cubeCount) {
+	const int frames = 20;
+
+	unsigned int VAO, VBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	GLState::instance().bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_POSITIONS), CUBE_POSITIONS, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	InstanceBuffer instances;
+	instances.attach();
+
+	//a square grid of small rotated cubes in front of the camera
+	std::vector<glm::mat4> transforms(cubeCount);
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((double)cubeCount));
+	for (unsigned int i = 0; i < cubeCount; i++) {
+		glm::vec3 position((float)(i % side) - side * .5f, (float)(i / side) - side * .5f, -(float)side);
+		transforms[i] = glm::rotate(glm::translate(glm::mat4(1.0f), position), glm::radians(20.0f * (i % 18)), glm::vec3(1.0f, 0.3f, 0.5f));
+	}
+	instances.upload(transforms);
+
+	unsigned int program = cubeFieldProgram();
+	GLState::instance().useProgram(program);
+	glm::mat4 viewProjection = glm::perspective(glm::radians(90.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 1000.0f);
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+	GLint modelLocation = glGetUniformLocation(program, "model");
+	GLint instancedLocation = glGetUniformLocation(program, "instanced");
+	glEnable(GL_DEPTH_TEST);
+
+	const char* names[] = { "per object        ", "instanced         ", "instanced + upload" };
+	for (int path = 0; path < 3; path++) {
+		glUniform1i(instancedLocation, path > 0);
+		double submitMs = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = -1; frame < frames; frame++) { //frame -1 warms up
+			if (frame == 0) {
+				glFinish();
+				submitMs = 0.0;
+				start = std::chrono::steady_clock::now();
+			}
+			auto submit = std::chrono::steady_clock::now();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			if (path == 0) {
+				for (unsigned int i = 0; i < cubeCount; i++) {
+					glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(transforms[i]));
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+				}
+			}
+			else {
+				if (path == 2) instances.upload(transforms);
+				instances.draw(GL_TRIANGLES, 0, 36);
+			}
+			submitMs += millisecondsSince(submit);
+		}
+		glFinish();
+		double totalMs = millisecondsSince(start) / frames;
+
+		std::cout << names[path] << ": " << (path ? 1 : cubeCount) << " draw calls/frame, submit " << submitMs / frames << " ms/frame, "
+			<< "total " << totalMs << " ms/frame, " << cubeCount / totalMs / 1000.0 << " M cubes/s" << std::endl;
+	}
+
+	GLState::instance().useProgram(0);
+	glDeleteProgram(program);
+	GLState::instance().vertexArrayDeleted(VAO);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	return 0;
+}
+
+
+//per-frame data of a cube field where everything moves: the old ways (a glUniformMatrix4fv per cube, an orphaning
+//glBufferData + glBufferSubData of the instance matrices) vs writing it into a persistently mapped StreamBuffer.
+//"fence waits": frames where the CPU got FRAME_COUNT frames ahead and had to wait for the GPU
+int benchStream(unsigned int cubeCount) {
+	const int frames = 60;
+	unsigned int VAO, VBO;
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	GLState::instance().bindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_POSITIONS), CUBE_POSITIONS, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	InstanceBuffer instances;
+	instances.attach();
+
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((double)cubeCount));
+	std::vector<glm::mat4> transforms(cubeCount);
+	auto animate = [&](int frame) {
+		for (unsigned int i = 0; i < cubeCount; i++) {
+			glm::vec3 position((float)(i % side) - side * .5f, (float)(i / side) - side * .5f, -(float)side);
+			transforms[i] = glm::rotate(glm::translate(glm::mat4(1.0f), position), glm::radians(20.0f * (i % 18) + frame), glm::vec3(1.0f, 0.3f, 0.5f));
+		}
+	};
+
+	unsigned int program = cubeFieldProgram();
+	GLState::instance().useProgram(program);
+	glm::mat4 viewProjection = glm::perspective(glm::radians(90.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 1000.0f);
+	glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Object"), OBJECT_BLOCK_BINDING);
+	GLint modelLocation = glGetUniformLocation(program, "model");
+	GLint instancedLocation = glGetUniformLocation(program, "instanced");
+	GLint streamedLocation = glGetUniformLocation(program, "streamed");
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	glEnable(GL_DEPTH_TEST);
+
+	//per object: one aligned ObjectBlock per cube. instanced: the matrices back to back
+	size_t objectStride = (sizeof(ObjectBlock) + alignment - 1) / alignment * alignment;
+	StreamBuffer stream(std::max(cubeCount * objectStride, cubeCount * sizeof(glm::mat4)) + alignment);
+	std::vector<GLintptr> offsets(cubeCount);
+
+	const char* names[] = { "per object, glUniform    ", "per object, stream buffer", "instanced, upload        ", "instanced, stream buffer " };
+	for (int path = 0; path < 4; path++) {
+		glUniform1i(instancedLocation, path >= 2);
+		glUniform1i(streamedLocation, path == 1);
+		size_t waits = stream.fenceWaits;
+		double waitMs = stream.fenceWaitMs;
+		double submitMs = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = -1; frame < frames; frame++) { //frame -1 warms up
+			animate(frame);
+			if (frame == 0) {
+				glFinish();
+				submitMs = 0.0;
+				waits = stream.fenceWaits;
+				waitMs = stream.fenceWaitMs;
+				start = std::chrono::steady_clock::now();
+			}
+			auto submit = std::chrono::steady_clock::now();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			if (path == 0) {
+				for (unsigned int i = 0; i < cubeCount; i++) {
+					glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(transforms[i]));
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+				}
+			}
+			else if (path == 1) {
+				//write every object linearly, then draw them bound by offset
+				stream.beginFrame();
+				for (unsigned int i = 0; i < cubeCount; i++) stream.allocate<ObjectBlock>(offsets[i], (size_t)alignment)->model = transforms[i];
+				stream.flush();
+				for (unsigned int i = 0; i < cubeCount; i++) {
+					stream.bindRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, offsets[i], sizeof(ObjectBlock));
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+				}
+				stream.endFrame();
+			}
+			else if (path == 2) {
+				instances.upload(transforms);
+				instances.draw(GL_TRIANGLES, 0, 36);
+			}
+			else {
+				stream.beginFrame();
+				instances.stream(stream, transforms.data(), cubeCount);
+				instances.draw(GL_TRIANGLES, 0, 36);
+				stream.endFrame();
+			}
+			submitMs += millisecondsSince(submit);
+		}
+		glFinish();
+		double totalMs = millisecondsSince(start) / frames;
+
+		std::cout << names[path] << ": submit " << submitMs / frames << " ms/frame, total " << totalMs << " ms/frame";
+		if (path == 1 || path == 3)
+			std::cout << ", " << stream.fenceWaits - waits << " fence waits (" << stream.fenceWaitMs - waitMs << " ms)";
+		std::cout << std::endl;
+	}
+	stream.printStats();
+
+	GLState::instance().useProgram(0);
+	glDeleteProgram(program);
+	GLState::instance().vertexArrayDeleted(VAO);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	return 0;
+}
+
+
+//a program that reads every vertex attribute, so the whole vertex gets fetched
+unsigned int vertexFetchProgram() {
+	const char* vertexShaderCode = "#version 410 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec3 aNormal;\n"
+		"layout (location = 2) in vec2 aTexCoords;\n"
+		"layout (location = 3) in vec4 aTangent;\n"
+		"void main(){ gl_Position = vec4(aPos + aNormal + aTangent.xyz * aTangent.w, aTexCoords.x + aTexCoords.y); }";
+	const char* fragmentShaderCode = "#version 410 core\n"
+		"out vec4 FragColor;"
+		"void main(){ FragColor = vec4(1.0); }";
+
+	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+	glCompileShader(vertexShader);
+	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+	glCompileShader(fragmentShader);
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	return program;
+}
+
+//the model loaded with the full and the packed vertex layout: vertex buffer size,
+//and every vertex of the arena fetched once per pass (points, rasterizer off: only the vertex fetch + shader is timed)
+int benchVertexFormat(const std::string& path) {
+	const int passes = 200;
+	unsigned int program = vertexFetchProgram();
+	GLState::instance().useProgram(program);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	const Vertex_Format formats[] = { VERTEX_FULL, VERTEX_PACKED };
+	const char* names[] = { "full  ", "packed" };
+	size_t bytes[2] = { 0, 0 };
+	for (int f = 0; f < 2; f++) {
+		ModelOptions options;
+		options.format = formats[f];
+		Model model(path, options);
+		bytes[f] = model.vertexBytes;
+		GLsizei vertexCount = (GLsizei)(model.vertexBytes / vertexSize(formats[f]));
+		GLState::instance().bindVertexArray(model.VAO);
+		glDrawArrays(GL_POINTS, 0, vertexCount); //warm up
+		glFinish();
+
+		auto start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++) glDrawArrays(GL_POINTS, 0, vertexCount);
+		glFinish();
+		double ms = millisecondsSince(start) / passes;
+
+		std::cout << names[f] << ": " << vertexSize(formats[f]) << " bytes/vertex, " << vertexCount << " vertices, "
+			<< model.vertexBytes / (1024.0 * 1024.0) << " MiB vertex buffer, " << ms << " ms/pass, "
+			<< model.vertexBytes / ms / 1.0e6 << " GB/s effective" << std::endl;
+	}
+	if (bytes[0]) std::cout << "packed vertex buffer is " << 100.0 - 100.0 * bytes[1] / bytes[0] << "% smaller" << std::endl;
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	GLState::instance().useProgram(0);
+	glDeleteProgram(program);
+	return 0;
+}
+
+
+//levels of detail: the same model drawn at growing distances, Draw(shader, camera, model) picks the levels
+int benchLODs(const std::string& path) {
+	const int frames = 100;
+	Shader shader;
+	ModelOptions options;
+	options.lods = true;
+	auto start = std::chrono::steady_clock::now();
+	Model model(path, options);
+	std::cout << "load + LOD chains: " << millisecondsSince(start) << " ms" << std::endl;
+	model.lodViewportHeight = (float)SCR_HEIGHT;
+	model.drawMode = DRAW_BATCHED;
+
+	Camera camera(glm::vec3(.0f, .0f, .0f));
+	shader.use();
+	shader.setMat4("projection", glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 1000.0f));
+	shader.setMat4("view", camera.GetViewMatrix());
+
+	const float distances[] = { 3.0f, 10.0f, 30.0f, 100.0f, 300.0f };
+	for (int d = 0; d < 5; d++) {
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(.0f, .0f, -distances[d]));
+		shader.setMat4("model", transform);
+		model.Draw(shader, camera, transform);
+		glFinish();
+
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) model.Draw(shader, camera, transform);
+		glFinish();
+		double ms = millisecondsSince(start) / frames;
+
+		model.Draw(shader);
+		size_t fullTriangles = model.trianglesSubmitted;
+		model.Draw(shader, camera, transform);
+		std::cout << "distance " << distances[d] << ": " << model.trianglesSubmitted << " of " << fullTriangles << " triangles/frame, "
+			<< ms << " ms/frame" << std::endl;
+	}
+	return 0;
+}
+
+
+//true if bound i touches one of the planes within float rounding: the only bounds the scalar and SSE kernels
+//may disagree on (a compiler may contract the scalar multiply-adds into FMA, see planeDistance())
+bool touchesPlane(const Frustum& frustum, const CullBounds& bounds, size_t i, bool boxes) {
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		double distance = (double)plane.x * bounds.centerX[i] + (double)plane.y * bounds.centerY[i] + (double)plane.z * bounds.centerZ[i] + plane.w;
+		double reach = boxes ? std::fabs((double)plane.x) * bounds.extentX[i] + std::fabs((double)plane.y) * bounds.extentY[i] + std::fabs((double)plane.z) * bounds.extentZ[i]
+			: (double)bounds.radius[i];
+		if (std::fabs(distance + reach) <= 1e-5 * (std::fabs(distance) + reach + std::fabs((double)plane.w))) return true;
+	}
+	return false;
+}
+
+//culling kernel throughput: the same bounds through the scalar and the SSE version
+//(results must match, except for bounds that touch a plane within rounding)
+int benchCull(unsigned int count) {
+	const int rounds = 200;
+	//random boxes in a 200^3 cube around a camera looking down -z: a few percent of them are in view
+	CullBounds bounds;
+	bounds.reserve(count);
+	unsigned int seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+	for (unsigned int i = 0; i < count; i++) {
+		glm::vec3 center(random() * 200.0f - 100.0f, random() * 200.0f - 100.0f, random() * 200.0f - 100.0f);
+		glm::vec3 extent(random() * 2.0f, random() * 2.0f, random() * 2.0f);
+		bounds.addBox(center - extent, center + extent);
+	}
+	Frustum frustum = extractFrustum(glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 150.0f)
+		* glm::lookAt(glm::vec3(.0f), glm::vec3(.0f, .0f, -1.0f), glm::vec3(.0f, 1.0f, .0f)));
+
+	typedef size_t(*CullKernel)(const Frustum&, const CullBounds&, unsigned char*);
+	CullKernel kernels[] = {
+		[](const Frustum& f, const CullBounds& b, unsigned char* v) { return cullSpheresScalar(f, b, v); },
+		[](const Frustum& f, const CullBounds& b, unsigned char* v) { return cullSpheres(f, b, v); },
+		[](const Frustum& f, const CullBounds& b, unsigned char* v) { return cullBoxesScalar(f, b, v); },
+		[](const Frustum& f, const CullBounds& b, unsigned char* v) { return cullBoxes(f, b, v); }
+	};
+	const char* names[] = { "spheres scalar", "spheres SSE   ", "boxes scalar  ", "boxes SSE     " };
+	std::vector<unsigned char> visible(count), reference(count);
+	bool failed = false;
+	for (int k = 0; k < 4; k++) {
+		size_t visibleCount = kernels[k](frustum, bounds, &visible[0]);
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; round++) visibleCount = kernels[k](frustum, bounds, &visible[0]);
+		double ms = millisecondsSince(start) / rounds;
+
+		//the SSE kernel of each shape must agree with its scalar reference
+		bool mismatch = false;
+		for (size_t i = 0; k % 2 == 1 && i < count; i++)
+			if (visible[i] != reference[i] && !touchesPlane(frustum, bounds, i, k == 3)) mismatch = true;
+		if (k % 2 == 0) reference = visible;
+		if (mismatch) failed = true;
+		std::cout << names[k] << ": " << visibleCount << " of " << count << " visible, " << ms << " ms/call, "
+			<< count / ms / 1000.0 << " M bounds/s" << (mismatch ? "  <-- MISMATCH" : "") << std::endl;
+	}
+#ifndef FRUSTUM_SSE
+	std::cout << "(no SSE in this build: both versions are the scalar one)" << std::endl;
+#endif
+	return failed ? 1 : 0;
+}
+
+
+
+
+int benchNodes(unsigned int count) {
+	const int rounds = 50;
+	//random tree: every node hangs under one of the nodes before it, a small rotation + offset per level
+	SceneGraph graph;
+	graph.reserve(count);
+	unsigned int seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+	auto randomLocal = [&random]() {
+		glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+		return glm::rotate(local, random() * 0.1f, glm::vec3(.0f, 1.0f, .0f));
+	};
+	for (unsigned int i = 0; i < count; i++) graph.addNode(i ? (unsigned int)(random() * i) : SceneGraph::NO_PARENT, randomLocal());
+	graph.update();
+
+	//every node dirty
+	auto start = std::chrono::steady_clock::now();
+	size_t updated = 0;
+	for (int round = 0; round < rounds; round++) {
+		for (unsigned int i = 0; i < count; i++) graph.setLocal(i, graph.locals[i]);
+		updated = graph.update();
+	}
+	double fullMs = millisecondsSince(start) / rounds;
+
+	//1% of the nodes changed (each drags its subtree along)
+	std::vector<unsigned int> moved;
+	for (unsigned int i = 0; i < count / 100; i++) moved.push_back((unsigned int)(random() * count));
+	start = std::chrono::steady_clock::now();
+	size_t partial = 0;
+	for (int round = 0; round < rounds; round++) {
+		for (unsigned int i = 0; i < moved.size(); i++) graph.setLocal(moved[i], randomLocal());
+		partial = graph.update();
+	}
+	double partialMs = millisecondsSince(start) / rounds;
+
+	//the kernel against glm's matrix product
+	float maxError = 0.0f;
+	for (unsigned int i = 0; i < count; i++) {
+		glm::mat4 expected = graph.parents[i] == SceneGraph::NO_PARENT ? graph.locals[i] : graph.worlds[graph.parents[i]] * graph.locals[i];
+		for (int column = 0; column < 4; column++)
+			for (int row = 0; row < 4; row++) maxError = std::max(maxError, std::fabs(expected[column][row] - graph.worlds[i][column][row]));
+	}
+	bool failed = maxError > 1e-3f;
+
+	std::cout << "full update   : " << updated << " nodes, " << fullMs << " ms, " << updated / fullMs / 1000.0 << " M nodes/s" << std::endl;
+	std::cout << "1% dirty      : " << partial << " nodes recomputed, " << partialMs << " ms" << std::endl;
+	std::cout << "max difference to glm: " << maxError << (failed ? "  <-- MISMATCH" : "") << std::endl;
+#ifndef SCENE_GRAPH_SSE
+	std::cout << "(no SSE in this build: scalar matrix product)" << std::endl;
+#endif
+	return failed ? 1 : 0;
+}
+
+
+
+
+//count programs that differ (so neither our cache nor the driver's can share them), blocking one by one vs all submitted up front
+void benchParallelShaders(unsigned int count) {
+	ProgramCache& cache = ProgramCache::instance();
+	bool cacheEnabled = cache.enabled;
+	cache.enabled = false;
+	std::vector<std::string> vertexCodes, fragmentCodes;
+	std::string stamp = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	for (unsigned int variant = 0; variant < 2 * count; variant++) {
+		std::string define = "#define VARIANT_" + stamp + "_" + std::to_string(variant) + "\n";
+		std::string vertexCode = Shader::vertexCode(), fragmentCode = Shader::fragmentCode();
+		vertexCode.insert(vertexCode.find('\n') + 1, define);
+		fragmentCode.insert(fragmentCode.find('\n') + 1, define);
+		vertexCodes.push_back(vertexCode);
+		fragmentCodes.push_back(fragmentCode);
+	}
+	std::vector<GLuint> programs;
+
+	//serial: what count Shader constructors do (status query right after each compile/link)
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < count; i++) {
+		ProgramBuilder builder;
+		programs.push_back(builder.program(builder.add(vertexCodes[i].c_str(), fragmentCodes[i].c_str())));
+		builder.finish();
+	}
+	double serialMs = millisecondsSince(start);
+
+	//all at once, then poll like a render loop would
+	start = std::chrono::steady_clock::now();
+	ProgramBuilder builder;
+	for (unsigned int i = count; i < 2 * count; i++) builder.add(vertexCodes[i].c_str(), fragmentCodes[i].c_str());
+	double submitMs = millisecondsSince(start);
+	unsigned int polls = 1;
+	while (!builder.poll()) polls++;
+	double parallelMs = millisecondsSince(start);
+	for (unsigned int i = 0; i < count; i++) programs.push_back(builder.program(i));
+
+	std::cout << count << " programs one by one : " << serialMs << " ms" << std::endl;
+	std::cout << count << " programs submitted   : " << submitMs << " ms to submit, all linked after " << parallelMs << " ms, "
+		<< polls << " polls (" << (builder.parallel ? "parallel shader compile" : "no parallel shader compile extension: one program per poll") << ")" << std::endl;
+	for (unsigned int i = 0; i < programs.size(); i++) glDeleteProgram(programs[i]);
+	cache.enabled = cacheEnabled;
+}
+
+int benchShaders(unsigned int count) {
+	const int rounds = 20;
+	benchParallelShaders(count);
+	ProgramCache& cache = ProgramCache::instance();
+	if (!cache.enabled) {
+		std::cout << "the driver offers no program binary format: every start compiles" << std::endl;
+		return 0;
+	}
+
+	//cold: no entry, compile + link + store (the driver's own shader cache may still help, it is not under our control)
+	double coldMs = 0.0;
+	for (int round = 0; round < rounds; round++) {
+		cache.clear();
+		auto start = std::chrono::steady_clock::now();
+		Shader shader;
+		coldMs += millisecondsSince(start);
+		glDeleteProgram(shader.ID);
+	}
+	//warm: the entry of the last cold round is there
+	unsigned int hits = cache.hits;
+	double warmMs = 0.0;
+	for (int round = 0; round < rounds; round++) {
+		auto start = std::chrono::steady_clock::now();
+		Shader shader;
+		warmMs += millisecondsSince(start);
+		glDeleteProgram(shader.ID);
+	}
+	hits = cache.hits - hits;
+
+	std::cout << "cold start: " << coldMs / rounds << " ms per program" << std::endl;
+	std::cout << "warm start: " << warmMs / rounds << " ms per program (" << hits << " of " << rounds << " loaded from " << cache.directory << ")" << std::endl;
+	return hits == (unsigned int)rounds ? 0 : 1;
+}
+
+
+
+
+//bytes of a texture's levels as the driver reports them (compressed size, or texels * the bits of the components)
+size_t textureBytes(unsigned int texture) {
+	GLState::instance().bindTexture(GL_TEXTURE_2D, texture);
+	size_t bytes = 0;
+	for (GLint level = 0; ; level++) {
+		GLint width = 0, height = 0, compressed = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		if (width == 0) break;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size;
+			continue;
+		}
+		GLint bits = 0;
+		const GLenum components[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE };
+		for (int c = 0; c < 4; c++) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, components[c], &size);
+			bits += size;
+		}
+		bytes += (size_t)width * height * bits / 8;
+	}
+	return bytes;
+}
+
+//the same texture from the source image and from the baked file: file to sampleable texture (glFinish included)
+int benchKTX2(const std::string& imagePath, const std::string& ktx2Path) {
+	const int rounds = 5;
+	KTX2Image baked;
+	if (!readKTX2(ktx2Path, baked)) {
+		std::cout << "bake it first: BakeTexture " << imagePath << " " << ktx2Path << std::endl;
+		return -1;
+	}
+	const char* names[] = { "image (stb_image + mips)", "ktx2 (compressed upload)", "ktx2 (CPU decode fallback)" };
+	double best[3] = { 1e30, 1e30, 1e30 };
+	size_t vram[3] = { 0, 0, 0 };
+	textureLoadOptions().preferKTX2 = false; //(the image path must not pick up the .ktx2)
+
+	for (int round = 0; round < rounds; round++) {
+		for (int path = 0; path < 3; path++) {
+			auto start = std::chrono::steady_clock::now();
+			unsigned int texture;
+			if (path < 2) {
+				DecodedImage image = decodeImage(path == 0 ? imagePath : ktx2Path);
+				texture = uploadTexture(image);
+			}
+			else {
+				KTX2Image file;
+				readKTX2(ktx2Path, file);
+				texture = uploadKTX2(file, false, false);
+			}
+			glFinish();
+			best[path] = std::min(best[path], millisecondsSince(start));
+			vram[path] = textureBytes(texture);
+			GLState::instance().textureDeleted(texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+	textureLoadOptions().preferKTX2 = true;
+
+	std::cout << imagePath << " vs " << ktx2Path << " (" << baked.width << "x" << baked.height << ", " << baked.levels.size() << " levels, "
+		<< (compressedFormatSupported(baked.format, false) ? "format supported by the GL" : "format NOT supported by the GL: decoded on the CPU") << ")" << std::endl;
+	for (int path = 0; path < 3; path++)
+		std::cout << names[path] << ": best " << best[path] << " ms, VRAM " << vram[path] / 1024 << " KB" << std::endl;
+	std::cout << "ktx2: x" << best[0] / best[1] << " faster, x" << (double)vram[0] / std::max(vram[1], (size_t)1) << " less VRAM" << std::endl;
+	return 0;
+}
+
+//the mip chain of one decoded image: uploaded + glGenerateMipmap on the GL thread vs generateMips() on the CPU
+//(throughput in MB of level 0 per second, best of a few rounds)
+int benchMips(const std::string& imagePath) {
+	const int rounds = 5;
+	int width, height, components;
+	unsigned char* pixels = stbi_load(imagePath.c_str(), &width, &height, &components, 0);
+	if (!pixels) {
+		std::cout << "cannot read " << imagePath << std::endl;
+		return -1;
+	}
+	double megabytes = (double)width * height * components / 1.0e6;
+	GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	GLenum format = formats[components - 1];
+	std::cout << imagePath << ": " << width << "x" << height << ", " << components << " components, "
+		<< mipLevelCount(width, height) << " levels" << std::endl;
+
+	//the driver's mips (level 0 upload included, it is needed either way)
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	double best = 1e30;
+	for (int round = 0; round < rounds; round++) {
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		GLState::instance().bindTexture(GL_TEXTURE_2D, texture);
+		auto start = std::chrono::steady_clock::now();
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		best = std::min(best, millisecondsSince(start));
+		GLState::instance().textureDeleted(texture);
+		glDeleteTextures(1, &texture);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	std::cout << "glTexImage2D + glGenerateMipmap  : " << best << " ms, " << megabytes / best * 1000.0 << " MB/s (GL thread)" << std::endl;
+
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	struct Run { Mip_Filter filter; unsigned int flags; bool simd; unsigned int threads; const char* name; };
+	const Run runs[] = {
+		{ MIP_BOX, 0, false, 1, "box, scalar, 1 thread           " },
+		{ MIP_BOX, 0, true, 1, "box, SIMD, 1 thread             " },
+		{ MIP_BOX, 0, true, hardwareThreads, "box, SIMD, all threads          " },
+		{ MIP_KAISER, 0, false, 1, "Kaiser, scalar, 1 thread        " },
+		{ MIP_KAISER, 0, true, 1, "Kaiser, SIMD, 1 thread          " },
+		{ MIP_KAISER, 0, true, hardwareThreads, "Kaiser, SIMD, all threads       " },
+		{ MIP_KAISER, MIP_SRGB, true, 1, "Kaiser sRGB, SIMD, 1 thread     " },
+		{ MIP_KAISER, MIP_NORMAL_MAP, true, 1, "Kaiser normals, SIMD, 1 thread  " },
+	};
+	for (const Run& run : runs) {
+		best = 1e30;
+		std::vector<std::vector<unsigned char>> levels;
+		for (int round = 0; round < rounds; round++) {
+			auto start = std::chrono::steady_clock::now();
+			generateMips(pixels, width, height, components, run.filter, run.flags, levels, run.threads, run.simd);
+			best = std::min(best, millisecondsSince(start));
+		}
+		std::cout << run.name << " : " << best << " ms, " << megabytes / best * 1000.0 << " MB/s" << std::endl;
+	}
+#ifdef MIP_AVX2
+	std::cout << "(SIMD: AVX2 vertical pass, SSE horizontal pass)" << std::endl;
+#else
+	std::cout << "(SIMD: SSE, build with AVX2 enabled for the 8 wide vertical pass)" << std::endl;
+#endif
+	stbi_image_free(pixels);
+	return 0;
+}
+
+
+//first frame of a model: Model construction with every texture decoded and uploaded vs with the textures only requested,
+//then the frames it takes update() to bring every level in under the per-frame budget.
+//each Model is gone before the next one loads, so nothing comes from the TextureCache.
+int benchStreaming(const std::string& path, float budgetMB) {
+	double fullMs;
+	{
+		auto start = std::chrono::steady_clock::now();
+		Model model(path);
+		glFinish();
+		fullMs = millisecondsSince(start);
+		std::cout << "textures up front: first frame after " << fullMs << " ms (" << model.textures_loaded.size() << " textures)" << std::endl;
+	}
+
+	TextureStreamer& streamer = TextureStreamer::instance();
+	ModelOptions streamed;
+	streamed.streamTextures = true;
+	auto start = std::chrono::steady_clock::now();
+	Model model(path, streamed);
+	glFinish();
+	double firstMs = millisecondsSince(start);
+	std::cout << "textures streamed: first frame after " << firstMs << " ms" << std::endl;
+
+	int frames = 0;
+	double worstUpdate = 0.0;
+	size_t uploaded = streamer.getStats().bytesUploaded;
+	while (streamer.streamingCount() > 0) {
+		auto frameStart = std::chrono::steady_clock::now();
+		streamer.update(budgetMB);
+		glFinish();
+		worstUpdate = std::max(worstUpdate, millisecondsSince(frameStart));
+		frames++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1)); //(the rest of a frame: the workers decode meanwhile)
+	}
+	double allMs = millisecondsSince(start);
+	std::cout << "every level resident after " << allMs << " ms, " << frames << " frames at " << budgetMB << " MB per frame ("
+		<< (streamer.getStats().bytesUploaded - uploaded) / (1024.0 * 1024.0) << " MB uploaded), worst update(): " << worstUpdate << " ms" << std::endl;
+	std::cout << "first frame x" << fullMs / std::max(firstMs, 0.001) << " sooner" << std::endl;
+	streamer.printStats();
+	return 0;
+}
+
+//count models: one after another with the blocking constructor (the render loop would stand still the whole time)
+//vs all at once through a ModelLoader, with a frame loop polling it. frame = poll() + TextureStreamer::update(4) + glFinish().
+//the textures are streamed in both cases, so only the import/convert/upload of the geometry differs.
+//(the TextureCache shares the textures between the copies: each copy still imports and uploads its own geometry)
+int benchAsync(const std::string& path, unsigned int count) {
+	typedef std::unique_ptr<Model> ModelPtr;
+	{
+		ModelOptions streamed;
+		streamed.streamTextures = true;
+		auto start = std::chrono::steady_clock::now();
+		std::vector<ModelPtr> models;
+		double longest = 0.0;
+		for (unsigned int i = 0; i < count; i++) {
+			auto loadStart = std::chrono::steady_clock::now();
+			models.push_back(ModelPtr(new Model(path, streamed)));
+			glFinish();
+			longest = std::max(longest, millisecondsSince(loadStart));
+		}
+		std::cout << "blocking   : " << count << " models drawable after " << millisecondsSince(start) << " ms, the GL thread stalls up to "
+			<< longest << " ms at a time (" << count << " stalls)" << std::endl;
+	}
+	while (TextureStreamer::instance().streamingCount()) TextureStreamer::instance().update(1000.0f); //(the streams of the deleted textures are gone)
+
+	ModelLoader loader;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ModelPtr> models;
+	for (unsigned int i = 0; i < count; i++) models.push_back(ModelPtr(new Model(loader, path)));
+	double submitMs = millisecondsSince(start);
+	int frames = 0;
+	double longest = 0.0;
+	while (true) {
+		auto frameStart = std::chrono::steady_clock::now();
+		bool done = loader.poll();
+		TextureStreamer::instance().update(4.0f);
+		glFinish();
+		longest = std::max(longest, millisecondsSince(frameStart));
+		frames++;
+		if (done) break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1)); //(the rest of a frame)
+	}
+	unsigned int ready = 0;
+	for (unsigned int i = 0; i < count; i++) ready += models[i]->ready() ? 1 : 0;
+	std::cout << "ModelLoader: " << ready << " models drawable after " << millisecondsSince(start) << " ms (" << loader.threadCount() << " workers, "
+		<< submitMs << " ms to submit), " << frames << " frames meanwhile, longest frame " << longest << " ms" << std::endl;
+	return ready == count ? 0 : -1;
+}
+
+
+int main(int argc, char** argv)
+{
+	std::string mode = argc > 1 ? argv[1] : "textures";
+
+	//offscreen context (surfaceless EGL where available, see RenderContext.h): runs on machines without a display/GPU
+	RenderOptions options;
+	options.headless = true;
+	options.frames = 0;
+	RenderContext renderContext(options, SCR_WIDTH, SCR_HEIGHT, "Xion's OpenGL Benchmark");
+	if (!renderContext.ok()) return -1;
+
+	TextureCache::instance().setFlipVertically(true);
+
+	int result = -1;
+	if (mode == "textures") result = benchTextures(argc > 2 ? argv[2] : "backpack/backpack.obj");
+	else if (mode == "bake" && argc > 3) result = benchBake(argv[2], argv[3]);
+	else if (mode == "draw") result = benchDraw(argc > 2 ? argv[2] : "backpack/backpack.obj");
+	else if (mode == "allocations") result = benchAllocations(argc > 2 ? argv[2] : "backpack/backpack.obj");
+	else if (mode == "cubes") result = benchCubes(argc > 2 ? (unsigned int)std::atoi(argv[2]) : 100000);
+	else if (mode == "stream") result = benchStream(argc > 2 ? (unsigned int)std::atoi(argv[2]) : 10000);
+	else if (mode == "lods") result = benchLODs(argc > 2 ? argv[2] : "backpack/backpack.obj");
+	else if (mode == "cull") result = benchCull(argc > 2 ? (unsigned int)std::atoi(argv[2]) : 100000);
+	else if (mode == "nodes") result = benchNodes(argc > 2 ? (unsigned int)std::atoi(argv[2]) : 100000);
+	else if (mode == "shaders") result = benchShaders(argc > 2 ? (unsigned int)std::atoi(argv[2]) : 8);
+	else if (mode == "ktx2") {
+		std::string image = argc > 2 ? argv[2] : "container2.png";
+		result = benchKTX2(image, argc > 3 ? argv[3] : image.substr(0, image.find_last_of('.')) + ".ktx2");
+	}
+	else if (mode == "mips") result = benchMips(argc > 2 ? argv[2] : "container2.png");
+	else if (mode == "async") result = benchAsync(argc > 2 ? argv[2] : "backpack/backpack.obj", argc > 3 ? (unsigned int)std::atoi(argv[3]) : 4);
+	else if (mode == "streaming") result = benchStreaming(argc > 2 ? argv[2] : "backpack/backpack.obj", argc > 3 ? (float)std::atof(argv[3]) : 4.0f);
+	else if (mode == "vertexformat") result = benchVertexFormat(argc > 2 ? argv[2] : "backpack/backpack.obj");
+	else std::cout << "unknown benchmark mode: " << mode << std::endl;
+	return result;
+}
@@ -0,0 +1,652 @@
+/*Block compression of RGBA8 images (BC1, BC3, BC5, BC7, ETC2 RGB), and decoders for a GL that can't sample a format.
+* Every format cuts the image into 4x4 texel blocks of 8 or 16 bytes: 4 or 8 bits per texel instead of the 32 of RGBA8.
+* The GPU samples the blocks as they are, so VRAM and texture bandwidth shrink by the same factor.
+*   BC1   RGB   8 bytes: two RGB565 endpoints, a 2 bit index per texel into the 4 colors on the line between them
+*   BC3   RGBA 16 bytes: a BC4 block for alpha (two 8 bit endpoints, 3 bit indices) + a BC1 block for the color
+*   BC5   RG   16 bytes: two BC4 blocks (normal maps: x and y, z is rebuilt in the shader)
+*   BC7   RGBA 16 bytes: the encoder writes mode 6 only (one RGBA endpoint pair of 7 bits + a shared low bit, 4 bit indices)
+*   ETC2  RGB   8 bytes: the encoder writes the ETC1 modes (two base colors, a table of intensity offsets per half block)
+* The encoders fit the endpoints to the principal axis of the block's colors and refine them once by least squares:
+* quick enough for a bake step, not as good as the exhaustive searches of the dedicated offline compressors.
+* The decoders read every mode of BC1/BC3/BC5 and ETC2 RGB, and the single subset modes (4, 5, 6) of BC7
+* (the partitioned modes 0-3 and 7 come out magenta).*/
+
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+
+enum Block_Format {
+	BLOCK_BC1,
+	BLOCK_BC3,
+	BLOCK_BC5,
+	BLOCK_BC7,
+	BLOCK_ETC2
+};
+
+inline unsigned int blockBytes(Block_Format format) { return format == BLOCK_BC1 || format == BLOCK_ETC2 ? 8 : 16; }
+
+//bytes of one compressed image (partial blocks at the right/bottom edge are whole blocks)
+inline size_t compressedSize(Block_Format format, int width, int height) {
+	return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * blockBytes(format);
+}
+
+
+
+//--- shared helpers ---
+
+inline int clampByte(int value) { return value < 0 ? 0 : (value > 255 ? 255 : value); }
+inline int quantize(float value, int levels) { //0..255 -> 0..levels - 1
+	int q = (int)std::floor(value * (levels - 1) / 255.0f + 0.5f);
+	return q < 0 ? 0 : (q >= levels ? levels - 1 : q);
+}
+
+//line through the texels (channels 3: rgb, 4: rgba): mean + principal axis of their covariance (power iteration),
+//then the two points of the line that enclose every texel's projection
+inline void fitLine(const unsigned char texels[16][4], int channels, float* low, float* high) {
+	float mean[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++) for (int c = 0; c < channels; c++) mean[c] += texels[i][c];
+	for (int c = 0; c < channels; c++) mean[c] /= 16.0f;
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++)
+		for (int a = 0; a < channels; a++)
+			for (int b = 0; b < channels; b++) covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+	float axis[4] = { 1, 1, 1, 1 };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = { 0, 0, 0, 0 }, length = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+			length = std::fmax(length, std::fabs(next[a]));
+		}
+		if (length < 1e-6f) break; //(all texels the same color: any axis does)
+		for (int a = 0; a < channels; a++) axis[a] = next[a] / length;
+	}
+	float lowT = 1e30f, highT = -1e30f, axisLength = 0.0f;
+	for (int c = 0; c < channels; c++) axisLength += axis[c] * axis[c];
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++) t += (texels[i][c] - mean[c]) * axis[c];
+		t /= axisLength;
+		lowT = std::fmin(lowT, t);
+		highT = std::fmax(highT, t);
+	}
+	for (int c = 0; c < channels; c++) {
+		low[c] = std::fmin(std::fmax(mean[c] + axis[c] * lowT, 0.0f), 255.0f);
+		high[c] = std::fmin(std::fmax(mean[c] + axis[c] * highT, 0.0f), 255.0f);
+	}
+}
+
+//least squares endpoints for fixed indices: texel i is low * (1 - weights[i]) + high * weights[i].
+//false if the weights don't pin down two endpoints (all the same)
+inline bool refitLine(const unsigned char texels[16][4], int channels, const float* weights, float* low, float* high) {
+	float a = 0, b = 0, c = 0, x0[4] = { 0, 0, 0, 0 }, x1[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++) {
+		float w = weights[i], v = 1.0f - w;
+		a += v * v; b += v * w; c += w * w;
+		for (int k = 0; k < channels; k++) { x0[k] += v * texels[i][k]; x1[k] += w * texels[i][k]; }
+	}
+	float determinant = a * c - b * b;
+	if (std::fabs(determinant) < 1e-6f) return false;
+	for (int k = 0; k < channels; k++) {
+		low[k] = std::fmin(std::fmax((c * x0[k] - b * x1[k]) / determinant, 0.0f), 255.0f);
+		high[k] = std::fmin(std::fmax((a * x1[k] - b * x0[k]) / determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+inline int squaredDistance(const int* a, const unsigned char* b, int channels) {
+	int sum = 0;
+	for (int c = 0; c < channels; c++) sum += (a[c] - b[c]) * (a[c] - b[c]);
+	return sum;
+}
+
+//BC7 bits are read/written from the least significant bit of byte 0 up
+struct BlockBits {
+	unsigned char* bytes;
+	unsigned int position;
+	void write(unsigned int value, unsigned int count) {
+		for (unsigned int i = 0; i < count; i++, position++)
+			if ((value >> i) & 1) bytes[position >> 3] |= (unsigned char)(1 << (position & 7));
+	}
+	unsigned int read(unsigned int count) {
+		unsigned int value = 0;
+		for (unsigned int i = 0; i < count; i++, position++) value |= ((bytes[position >> 3] >> (position & 7)) & 1u) << i;
+		return value;
+	}
+};
+
+//ETC blocks are one big endian 64 bit word
+inline uint64_t readBigEndian64(const unsigned char* bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < 8; i++) value = (value << 8) | bytes[i];
+	return value;
+}
+inline void writeBigEndian64(uint64_t value, unsigned char* bytes) {
+	for (int i = 7; i >= 0; i--, value >>= 8) bytes[i] = (unsigned char)(value & 0xFF);
+}
+
+
+
+//--- BC1 ---
+
+inline uint16_t packRGB565(const float* color) {
+	return (uint16_t)((quantize(color[0], 32) << 11) | (quantize(color[1], 64) << 5) | quantize(color[2], 32));
+}
+inline void unpackRGB565(uint16_t value, int* color) {
+	int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+//the 4 colors of a BC1 block (c0 <= c1: 3 colors + transparent black, the mode the encoder never writes)
+inline void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][4], bool fourColors) {
+	unpackRGB565(c0, palette[0]);
+	unpackRGB565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	for (int c = 0; c < 3; c++) {
+		if (fourColors) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[3][3] = fourColors ? 255 : 0;
+}
+
+//nearest palette color per texel, returns the total squared error
+inline int bc1Indices(const unsigned char texels[16][4], uint16_t c0, uint16_t c1, unsigned char* indices) {
+	int palette[4][4], error = 0;
+	bc1Palette(c0, c1, palette, true);
+	for (int i = 0; i < 16; i++) {
+		int best = 0, bestError = squaredDistance(palette[0], texels[i], 3);
+		for (int p = 1; p < 4; p++) {
+			int e = squaredDistance(palette[p], texels[i], 3);
+			if (e < bestError) { best = p; bestError = e; }
+		}
+		indices[i] = (unsigned char)best;
+		error += bestError;
+	}
+	return error;
+}
+
+inline void encodeBC1(const unsigned char texels[16][4], unsigned char* out) {
+	float low[4], high[4];
+	fitLine(texels, 3, low, high);
+	uint16_t c0 = packRGB565(high), c1 = packRGB565(low);
+	unsigned char indices[16], refined[16];
+	int error = bc1Indices(texels, c0, c1, indices);
+
+	//refit to the indices (index 0: c0, 1: c1, 2: 1/3 of the way, 3: 2/3)
+	static const float weightOf[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float weights[16];
+	for (int i = 0; i < 16; i++) weights[i] = weightOf[indices[i]];
+	if (refitLine(texels, 3, weights, high, low)) {
+		uint16_t r0 = packRGB565(high), r1 = packRGB565(low);
+		int refinedError = bc1Indices(texels, r0, r1, refined);
+		if (refinedError < error) {
+			c0 = r0; c1 = r1;
+			memcpy(indices, refined, 16);
+		}
+	}
+
+	//c0 > c1 selects the 4 color mode: swap the endpoints (and the indices with them) if needed
+	if (c0 < c1) {
+		uint16_t swap = c0; c0 = c1; c1 = swap;
+		static const unsigned char swapped[4] = { 1, 0, 3, 2 };
+		for (int i = 0; i < 16; i++) indices[i] = swapped[indices[i]];
+	}
+	else if (c0 == c1) memset(indices, 0, 16);
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++) bits |= (uint32_t)indices[i] << (2 * i);
+	out[0] = (unsigned char)(c0 & 0xFF); out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)(c1 & 0xFF); out[3] = (unsigned char)(c1 >> 8);
+	for (int i = 0; i < 4; i++) out[4 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+//alwaysFourColors: the color half of a BC3 block (no 3 color mode there)
+inline void decodeBC1(const unsigned char* block, unsigned char texels[16][4], bool alwaysFourColors = false) {
+	uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8)), c1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	int palette[4][4];
+	bc1Palette(c0, c1, palette, alwaysFourColors || c0 > c1);
+	for (int i = 0; i < 16; i++) {
+		const int* color = palette[(bits >> (2 * i)) & 3];
+		for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)color[c];
+	}
+}
+
+
+
+//--- BC4 (one channel: the alpha of BC3, each channel of BC5) ---
+
+inline void bc4Palette(int a0, int a1, int palette[8]) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+	else {
+		for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+//channel: which byte of the texels
+inline void encodeBC4(const unsigned char texels[16][4], int channel, unsigned char* out) {
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; i++) {
+		if (texels[i][channel] < low) low = texels[i][channel];
+		if (texels[i][channel] > high) high = texels[i][channel];
+	}
+	int palette[8];
+	bc4Palette(high, low, palette);
+	uint64_t bits = 0;
+	if (high > low) {
+		for (int i = 0; i < 16; i++) {
+			int best = 0, bestError = 256;
+			for (int p = 0; p < 8; p++) {
+				int e = std::abs(palette[p] - texels[i][channel]);
+				if (e < bestError) { best = p; bestError = e; }
+			}
+			bits |= (uint64_t)best << (3 * i);
+		}
+	}
+	out[0] = (unsigned char)high;
+	out[1] = (unsigned char)low;
+	for (int i = 0; i < 6; i++) out[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+inline void decodeBC4(const unsigned char* block, unsigned char texels[16][4], int channel) {
+	int palette[8];
+	bc4Palette(block[0], block[1], palette);
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++) bits |= (uint64_t)block[2 + i] << (8 * i);
+	for (int i = 0; i < 16; i++) texels[i][channel] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+}
+
+
+
+//--- BC7 ---
+
+static const int BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+static const int BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline int bc7Interpolate(int e0, int e1, int weight) { return ((64 - weight) * e0 + weight * e1 + 32) >> 6; }
+
+//mode 6 endpoints: 7 bit value + shared low bit per endpoint
+struct BC7Mode6 {
+	int endpoint[2][4]; //7 bits
+	int pbit[2];
+	unsigned char indices[16];
+	int error;
+};
+
+inline void bc7Mode6Indices(const unsigned char texels[16][4], BC7Mode6& mode) {
+	int palette[16][4], e0[4], e1[4];
+	for (int c = 0; c < 4; c++) {
+		e0[c] = (mode.endpoint[0][c] << 1) | mode.pbit[0];
+		e1[c] = (mode.endpoint[1][c] << 1) | mode.pbit[1];
+	}
+	for (int p = 0; p < 16; p++) for (int c = 0; c < 4; c++) palette[p][c] = bc7Interpolate(e0[c], e1[c], BC7_WEIGHTS4[p]);
+	mode.error = 0;
+	for (int i = 0; i < 16; i++) {
+		int best = 0, bestError = squaredDistance(palette[0], texels[i], 4);
+		for (int p = 1; p < 16; p++) {
+			int e = squaredDistance(palette[p], texels[i], 4);
+			if (e < bestError) { best = p; bestError = e; }
+		}
+		mode.indices[i] = (unsigned char)best;
+		mode.error += bestError;
+	}
+}
+
+//the best of the 4 shared bit combinations for a pair of float endpoints
+inline void bc7Mode6Quantize(const unsigned char texels[16][4], const float* low, const float* high, BC7Mode6& best) {
+	for (int p = 0; p < 4; p++) {
+		BC7Mode6 mode;
+		mode.pbit[0] = p & 1;
+		mode.pbit[1] = p >> 1;
+		//8 bit value = 7 bits << 1 | shared bit
+		for (int c = 0; c < 4; c++) {
+			mode.endpoint[0][c] = std::min(std::max((int)std::floor((low[c] - mode.pbit[0]) / 2.0f + 0.5f), 0), 127);
+			mode.endpoint[1][c] = std::min(std::max((int)std::floor((high[c] - mode.pbit[1]) / 2.0f + 0.5f), 0), 127);
+		}
+		bc7Mode6Indices(texels, mode);
+		if (mode.error < best.error) best = mode;
+	}
+}
+
+inline void encodeBC7(const unsigned char texels[16][4], unsigned char* out) {
+	float low[4], high[4];
+	fitLine(texels, 4, low, high);
+	BC7Mode6 best;
+	best.error = 0x7FFFFFFF;
+	bc7Mode6Quantize(texels, low, high, best);
+	float weights[16];
+	for (int i = 0; i < 16; i++) weights[i] = BC7_WEIGHTS4[best.indices[i]] / 64.0f;
+	if (refitLine(texels, 4, weights, low, high)) bc7Mode6Quantize(texels, low, high, best);
+
+	//the index of texel 0 has an implicit high bit of 0: flip the line if it would be 1
+	if (best.indices[0] & 8) {
+		for (int c = 0; c < 4; c++) { int swap = best.endpoint[0][c]; best.endpoint[0][c] = best.endpoint[1][c]; best.endpoint[1][c] = swap; }
+		int swap = best.pbit[0]; best.pbit[0] = best.pbit[1]; best.pbit[1] = swap;
+		for (int i = 0; i < 16; i++) best.indices[i] = (unsigned char)(15 - best.indices[i]);
+	}
+
+	memset(out, 0, 16);
+	BlockBits bits = { out, 0 };
+	bits.write(1 << 6, 7); //mode 6: six 0 bits and a 1
+	for (int c = 0; c < 4; c++) {
+		bits.write(best.endpoint[0][c], 7);
+		bits.write(best.endpoint[1][c], 7);
+	}
+	bits.write(best.pbit[0], 1);
+	bits.write(best.pbit[1], 1);
+	bits.write(best.indices[0], 3);
+	for (int i = 1; i < 16; i++) bits.write(best.indices[i], 4);
+}
+
+inline void decodeBC7(const unsigned char* block, unsigned char texels[16][4]) {
+	int mode = 0;
+	while (mode < 8 && !((block[0] >> mode) & 1)) mode++;
+	if (mode < 4 || mode == 7 || mode == 8) {
+		//partitioned (or reserved) mode: not decoded
+		for (int i = 0; i < 16; i++) { texels[i][0] = 255; texels[i][1] = 0; texels[i][2] = 255; texels[i][3] = 255; }
+		return;
+	}
+	BlockBits bits = { (unsigned char*)block, (unsigned int)mode + 1 };
+	int e0[4], e1[4];
+	int rotation = 0, indexMode = 0;
+	unsigned int colorIndices[16], alphaIndices[16];
+	const int* colorWeights;
+	const int* alphaWeights;
+	if (mode == 6) {
+		for (int c = 0; c < 4; c++) { e0[c] = bits.read(7); e1[c] = bits.read(7); }
+		int p0 = bits.read(1), p1 = bits.read(1);
+		for (int c = 0; c < 4; c++) { e0[c] = (e0[c] << 1) | p0; e1[c] = (e1[c] << 1) | p1; }
+		for (int i = 0; i < 16; i++) colorIndices[i] = alphaIndices[i] = bits.read(i == 0 ? 3 : 4);
+		colorWeights = alphaWeights = BC7_WEIGHTS4;
+	}
+	else {
+		//modes 4 and 5: color and alpha with separate indices, rotation swaps alpha with a color channel afterwards
+		rotation = bits.read(2);
+		if (mode == 4) indexMode = bits.read(1);
+		int colorBits = mode == 4 ? 5 : 7, alphaBits = mode == 4 ? 6 : 8;
+		for (int c = 0; c < 3; c++) { e0[c] = bits.read(colorBits); e1[c] = bits.read(colorBits); }
+		e0[3] = bits.read(alphaBits); e1[3] = bits.read(alphaBits);
+		for (int c = 0; c < 3; c++) {
+			e0[c] = (e0[c] << (8 - colorBits)) | (e0[c] >> (2 * colorBits - 8));
+			e1[c] = (e1[c] << (8 - colorBits)) | (e1[c] >> (2 * colorBits - 8));
+		}
+		if (alphaBits == 6) { e0[3] = (e0[3] << 2) | (e0[3] >> 4); e1[3] = (e1[3] << 2) | (e1[3] >> 4); }
+		//first index set: 2 bits, second: 3 bits (mode 4) or 2 bits (mode 5)
+		unsigned int first[16], second[16];
+		int secondBits = mode == 4 ? 3 : 2;
+		for (int i = 0; i < 16; i++) first[i] = bits.read(i == 0 ? 1 : 2);
+		for (int i = 0; i < 16; i++) second[i] = bits.read(i == 0 ? secondBits - 1 : secondBits);
+		const int* secondWeights = mode == 4 ? BC7_WEIGHTS3 : BC7_WEIGHTS2;
+		if (indexMode) {
+			memcpy(colorIndices, second, sizeof(second)); colorWeights = secondWeights;
+			memcpy(alphaIndices, first, sizeof(first)); alphaWeights = BC7_WEIGHTS2;
+		}
+		else {
+			memcpy(colorIndices, first, sizeof(first)); colorWeights = BC7_WEIGHTS2;
+			memcpy(alphaIndices, second, sizeof(second)); alphaWeights = secondWeights;
+		}
+	}
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) texels[i][c] = (unsigned char)bc7Interpolate(e0[c], e1[c], colorWeights[colorIndices[i]]);
+		texels[i][3] = (unsigned char)bc7Interpolate(e0[3], e1[3], alphaWeights[alphaIndices[i]]);
+		if (rotation) {
+			unsigned char swap = texels[i][3];
+			texels[i][3] = texels[i][rotation - 1];
+			texels[i][rotation - 1] = swap;
+		}
+	}
+}
+
+
+
+//--- ETC2 RGB ---
+
+//intensity offsets of the ETC1 modes: table -> { small, large }. index 0: +small, 1: +large, 2: -small, 3: -large
+static const int ETC_MODIFIERS[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+//distances of the ETC2 T and H modes
+static const int ETC_DISTANCES[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+inline int etcModifier(int table, int index) {
+	int value = ETC_MODIFIERS[table][index & 1];
+	return index & 2 ? -value : value;
+}
+
+//texel i (row major) -> bit of its index in the ETC layout (column major)
+inline int etcTexelBit(int i) { return (i & 3) * 4 + (i >> 2); }
+
+//true if texel i is in the second half block
+inline bool etcSecondHalf(int i, bool flip) { return flip ? (i >> 2) >= 2 : (i & 3) >= 2; }
+
+//best table and indices for the texels of one half block around a base color. returns the squared error
+inline int etcFitHalf(const unsigned char texels[16][4], bool flip, bool second, const int* base, int& tableOut, int* indicesOut) {
+	int bestError = 0x7FFFFFFF;
+	for (int table = 0; table < 8; table++) {
+		int error = 0, indices[16];
+		for (int i = 0; i < 16 && error < bestError; i++) {
+			if (etcSecondHalf(i, flip) != second) continue;
+			int best = 0, bestTexelError = 0x7FFFFFFF;
+			for (int index = 0; index < 4; index++) {
+				int modifier = etcModifier(table, index), color[3];
+				for (int c = 0; c < 3; c++) color[c] = clampByte(base[c] + modifier);
+				int e = squaredDistance(color, texels[i], 3);
+				if (e < bestTexelError) { best = index; bestTexelError = e; }
+			}
+			indices[i] = best;
+			error += bestTexelError;
+		}
+		if (error < bestError) {
+			bestError = error;
+			tableOut = table;
+			for (int i = 0; i < 16; i++) if (etcSecondHalf(i, flip) == second) indicesOut[i] = indices[i];
+		}
+	}
+	return bestError;
+}
+
+inline void encodeETC2(const unsigned char texels[16][4], unsigned char* out) {
+	uint64_t bestBits = 0;
+	int bestError = 0x7FFFFFFF;
+	for (int flip = 0; flip < 2; flip++) {
+		float average[2][3] = {};
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < 3; c++) average[etcSecondHalf(i, flip != 0)][c] += texels[i][c] / 8.0f;
+
+		for (int differential = 0; differential < 2; differential++) {
+			int quantized[2][3], base[2][3];
+			bool valid = true;
+			for (int half = 0; half < 2; half++) {
+				for (int c = 0; c < 3; c++) {
+					int q = quantize(average[half][c], differential ? 32 : 16);
+					quantized[half][c] = q;
+					base[half][c] = differential ? (q << 3) | (q >> 2) : (q << 4) | q;
+				}
+			}
+			//the second color is stored as a 3 bit difference to the first
+			for (int c = 0; c < 3 && differential; c++) {
+				int delta = quantized[1][c] - quantized[0][c];
+				if (delta < -4 || delta > 3) valid = false;
+			}
+			if (!valid) continue;
+
+			int tables[2], indices[16];
+			int error = etcFitHalf(texels, flip != 0, false, base[0], tables[0], indices);
+			if (error >= bestError) continue;
+			error += etcFitHalf(texels, flip != 0, true, base[1], tables[1], indices);
+			if (error >= bestError) continue;
+
+			uint64_t bits = 0;
+			for (int c = 0; c < 3; c++) {
+				int shift = 56 - 8 * c;
+				if (differential) bits |= ((uint64_t)quantized[0][c] << (shift + 3)) | ((uint64_t)((quantized[1][c] - quantized[0][c]) & 7) << shift);
+				else bits |= ((uint64_t)quantized[0][c] << (shift + 4)) | ((uint64_t)quantized[1][c] << shift);
+			}
+			bits |= (uint64_t)tables[0] << 37 | (uint64_t)tables[1] << 34 | (uint64_t)differential << 33 | (uint64_t)flip << 32;
+			for (int i = 0; i < 16; i++) {
+				int bit = etcTexelBit(i);
+				bits |= (uint64_t)(indices[i] >> 1) << (16 + bit) | (uint64_t)(indices[i] & 1) << bit;
+			}
+			bestError = error;
+			bestBits = bits;
+		}
+	}
+	writeBigEndian64(bestBits, out);
+}
+
+inline void decodeETC2(const unsigned char* block, unsigned char texels[16][4]) {
+	uint64_t bits = readBigEndian64(block);
+	auto field = [bits](int low, int count) { return (int)((bits >> low) & ((1u << count) - 1)); };
+	auto expand4 = [](int v) { return (v << 4) | v; };
+	for (int i = 0; i < 16; i++) texels[i][3] = 255;
+	int index[16];
+	for (int i = 0; i < 16; i++) {
+		int bit = etcTexelBit(i);
+		index[i] = (field(16 + bit, 1) << 1) | field(bit, 1);
+	}
+
+	bool differential = field(33, 1) != 0;
+	int r = field(59, 5), g = field(51, 5), b = field(43, 5);
+	int dr = field(56, 3), dg = field(48, 3), db = field(40, 3);
+	dr = dr >= 4 ? dr - 8 : dr; dg = dg >= 4 ? dg - 8 : dg; db = db >= 4 ? db - 8 : db;
+
+	if (!differential || (r + dr >= 0 && r + dr <= 31 && g + dg >= 0 && g + dg <= 31 && b + db >= 0 && b + db <= 31)) {
+		//ETC1 individual/differential: two half blocks with a base color and a modifier table each
+		int base[2][3];
+		if (differential) {
+			int first[3] = { r, g, b }, second[3] = { r + dr, g + dg, b + db };
+			for (int c = 0; c < 3; c++) {
+				base[0][c] = (first[c] << 3) | (first[c] >> 2);
+				base[1][c] = (second[c] << 3) | (second[c] >> 2);
+			}
+		}
+		else for (int c = 0; c < 3; c++) {
+			base[0][c] = expand4(field(60 - 8 * c, 4));
+			base[1][c] = expand4(field(56 - 8 * c, 4));
+		}
+		int tables[2] = { field(37, 3), field(34, 3) };
+		bool flip = field(32, 1) != 0;
+		for (int i = 0; i < 16; i++) {
+			int half = etcSecondHalf(i, flip), modifier = etcModifier(tables[half], index[i]);
+			for (int c = 0; c < 3; c++) texels[i][c] = (unsigned char)clampByte(base[half][c] + modifier);
+		}
+		return;
+	}
+
+	int paint[4][3];
+	if (r + dr < 0 || r + dr > 31) {
+		//T mode: one color alone, the other with +-distance
+		int c0[3] = { expand4((field(59, 2) << 2) | field(56, 2)), expand4(field(52, 4)), expand4(field(48, 4)) };
+		int c1[3] = { expand4(field(44, 4)), expand4(field(40, 4)), expand4(field(36, 4)) };
+		int distance = ETC_DISTANCES[(field(34, 2) << 1) | field(32, 1)];
+		for (int c = 0; c < 3; c++) {
+			paint[0][c] = c0[c];
+			paint[1][c] = clampByte(c1[c] + distance);
+			paint[2][c] = c1[c];
+			paint[3][c] = clampByte(c1[c] - distance);
+		}
+	}
+	else if (g + dg < 0 || g + dg > 31) {
+		//H mode: both colors with +-distance, the order of the colors is the low bit of the distance index
+		int raw0[3] = { field(59, 4), (field(56, 3) << 1) | field(52, 1), (field(51, 1) << 3) | field(47, 3) };
+		int raw1[3] = { field(43, 4), field(39, 4), field(35, 4) };
+		int value0 = (raw0[0] << 8) | (raw0[1] << 4) | raw0[2], value1 = (raw1[0] << 8) | (raw1[1] << 4) | raw1[2];
+		int distance = ETC_DISTANCES[(field(34, 1) << 2) | (field(32, 1) << 1) | (value0 >= value1 ? 1 : 0)];
+		for (int c = 0; c < 3; c++) {
+			paint[0][c] = clampByte(expand4(raw0[c]) + distance);
+			paint[1][c] = clampByte(expand4(raw0[c]) - distance);
+			paint[2][c] = clampByte(expand4(raw1[c]) + distance);
+			paint[3][c] = clampByte(expand4(raw1[c]) - distance);
+		}
+	}
+	else {
+		//planar mode: a color gradient through the origin, horizontal and vertical colors
+		int origin[3] = { field(57, 6), (field(56, 1) << 6) | field(49, 6), (field(48, 1) << 5) | (field(43, 2) << 3) | field(39, 3) };
+		int horizontal[3] = { (field(34, 5) << 1) | field(32, 1), field(25, 7), field(19, 6) };
+		int vertical[3] = { field(13, 6), field(6, 7), field(0, 6) };
+		for (int c = 0; c < 3; c++) {
+			int shift = c == 1 ? 1 : 2; //green has 7 bits, red and blue 6
+			int width = c == 1 ? 7 : 6;
+			origin[c] = (origin[c] << shift) | (origin[c] >> (width - shift));
+			horizontal[c] = (horizontal[c] << shift) | (horizontal[c] >> (width - shift));
+			vertical[c] = (vertical[c] << shift) | (vertical[c] >> (width - shift));
+		}
+		for (int i = 0; i < 16; i++) {
+			int x = i & 3, y = i >> 2;
+			for (int c = 0; c < 3; c++)
+				texels[i][c] = (unsigned char)clampByte((x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) >> 2);
+		}
+		return;
+	}
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++) texels[i][c] = (unsigned char)paint[index[i]][c];
+}
+
+
+
+//--- whole images ---
+
+//compress an RGBA8 image (4 bytes per texel, rows top to bottom as stored) into compressedSize() bytes
+inline void compressImage(Block_Format format, const unsigned char* rgba, int width, int height, unsigned char* out) {
+	unsigned char texels[16][4];
+	for (int blockY = 0; blockY < height; blockY += 4) {
+		for (int blockX = 0; blockX < width; blockX += 4) {
+			//edge blocks repeat the last row/column
+			for (int i = 0; i < 16; i++) {
+				int x = blockX + (i & 3), y = blockY + (i >> 2);
+				if (x >= width) x = width - 1;
+				if (y >= height) y = height - 1;
+				memcpy(texels[i], rgba + ((size_t)y * width + x) * 4, 4);
+			}
+			switch (format) {
+			case BLOCK_BC1: encodeBC1(texels, out); break;
+			case BLOCK_BC3: encodeBC4(texels, 3, out); encodeBC1(texels, out + 8); break;
+			case BLOCK_BC5: encodeBC4(texels, 0, out); encodeBC4(texels, 1, out + 8); break;
+			case BLOCK_BC7: encodeBC7(texels, out); break;
+			case BLOCK_ETC2: encodeETC2(texels, out); break;
+			}
+			out += blockBytes(format);
+		}
+	}
+}
+
+//the reverse: blocks -> RGBA8 (BC5: red, green, 0, 255)
+inline void decompressImage(Block_Format format, const unsigned char* blocks, int width, int height, unsigned char* rgba) {
+	unsigned char texels[16][4];
+	for (int blockY = 0; blockY < height; blockY += 4) {
+		for (int blockX = 0; blockX < width; blockX += 4) {
+			switch (format) {
+			case BLOCK_BC1: decodeBC1(blocks, texels); break;
+			case BLOCK_BC3: decodeBC1(blocks + 8, texels, true); decodeBC4(blocks, texels, 3); break;
+			case BLOCK_BC5:
+				decodeBC4(blocks, texels, 0); decodeBC4(blocks + 8, texels, 1);
+				for (int i = 0; i < 16; i++) { texels[i][2] = 0; texels[i][3] = 255; }
+				break;
+			case BLOCK_BC7: decodeBC7(blocks, texels); break;
+			case BLOCK_ETC2: decodeETC2(blocks, texels); break;
+			}
+			for (int i = 0; i < 16; i++) {
+				int x = blockX + (i & 3), y = blockY + (i >> 2);
+				if (x < width && y < height) memcpy(rgba + ((size_t)y * width + x) * 4, texels[i], 4);
+			}
+			blocks += blockBytes(format);
+		}
+	}
+}
+#endif // !BLOCK_COMPRESSION_H
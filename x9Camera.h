@@ -66,7 +66,7 @@ public:
 
 
 	//returns the view matrix calculated using Euler Angles and the LookAt Matrix
-	glm::mat4 GetViewMatrix() {
+	glm::mat4 GetViewMatrix() const {
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
@@ -0,0 +1,91 @@
+/*Change notification for a few files (shader sources that are edited while the program runs).
+* Linux: inotify on the files' directories, read without blocking, so changed() costs one read() per call.
+* The directory is watched rather than the file because editors often save by writing a new file
+* and renaming it over the old one, which a watch on the old file would never see.
+* Elsewhere: the files' modification times are compared on every changed() call.*/
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+class FileWatcher
+{
+public:
+	FileWatcher() {
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	}
+	~FileWatcher() {
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
+	}
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void watch(const std::string& path) {
+		std::filesystem::path file(path);
+		Entry entry;
+		entry.directory = file.has_parent_path() ? file.parent_path().string() : ".";
+		entry.name = file.filename().string();
+		entry.path = path;
+		std::error_code error;
+		entry.modified = std::filesystem::last_write_time(path, error);
+		entry.handle = -1;
+#ifdef __linux__
+		entry.handle = fd >= 0 ? inotify_add_watch(fd, entry.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) : -1;
+#endif
+		entries.push_back(entry);
+	}
+
+	//true if any watched file was written since the last call
+	bool changed() {
+		bool any = false;
+#ifdef __linux__
+		if (fd >= 0) {
+			//(aligned like struct inotify_event, room for many events with names)
+			alignas(struct inotify_event) char buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+				for (char* at = buffer; at < buffer + length;) {
+					const struct inotify_event* event = (const struct inotify_event*)at;
+					for (size_t i = 0; i < entries.size() && event->len; i++)
+						if (entries[i].handle == event->wd && entries[i].name == event->name) any = true;
+					at += sizeof(struct inotify_event) + event->len;
+				}
+			}
+			return any;
+		}
+#endif
+		for (size_t i = 0; i < entries.size(); i++) {
+			std::error_code error;
+			std::filesystem::file_time_type modified = std::filesystem::last_write_time(entries[i].path, error);
+			if (error || modified == entries[i].modified) continue;
+			entries[i].modified = modified;
+			any = true;
+		}
+		return any;
+	}
+
+private:
+	struct Entry {
+		std::string directory, name, path;
+		std::filesystem::file_time_type modified; //(fallback without inotify)
+		int handle;                               //inotify watch of the directory
+	};
+	std::vector<Entry> entries;
+#ifdef __linux__
+	int fd; //inotify instance, -1 if it couldn't be created (then the modification times are used)
+#endif
+};
+#endif // !FILE_WATCHER_H
@@ -0,0 +1,185 @@
+/*View-frustum culling.
+* extractFrustum() takes the 6 planes out of a projection * view (* model) matrix (Gribb & Hartmann):
+* a point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all of them.
+* With the model matrix included, the planes are in model space and the bounds don't need transforming.
+* CullBounds keeps the bounds as separate arrays (center x, y, z, extent x, y, z, radius),
+* so cullSpheres()/cullBoxes() test 4 bounds per SSE instruction against each plane.
+* Both are conservative: a bound that only touches a plane counts as visible.*/
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+//the 6 planes, normalized (w: distance of the origin), normals point inwards
+struct Frustum {
+	glm::vec4 planes[6]; //left, right, bottom, top, near, far
+};
+
+//planes of the clip volume of a matrix (GL clip space: -w <= x, y, z <= w)
+inline Frustum extractFrustum(const glm::mat4& m) {
+	//row i of the matrix (glm is column major: m[column][row])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+	for (int i = 0; i < 6; i++) {
+		glm::vec4& plane = frustum.planes[i];
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f) plane = plane * (1.0f / length);
+	}
+	return frustum;
+}
+
+//bounds of many objects, one array per component
+struct CullBounds {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ; //half size of the box (0 for sphere-only bounds)
+	std::vector<float> radius;
+
+	size_t size() const { return radius.size(); }
+	void clear() {
+		centerX.clear(); centerY.clear(); centerZ.clear();
+		extentX.clear(); extentY.clear(); extentZ.clear();
+		radius.clear();
+	}
+	void reserve(size_t count) {
+		centerX.reserve(count); centerY.reserve(count); centerZ.reserve(count);
+		extentX.reserve(count); extentY.reserve(count); extentZ.reserve(count);
+		radius.reserve(count);
+	}
+	void addSphere(const glm::vec3& center, float r) {
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		extentX.push_back(r); extentY.push_back(r); extentZ.push_back(r);
+		radius.push_back(r);
+	}
+	void resize(size_t count) {
+		centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+		extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+		radius.resize(count);
+	}
+	//overwrite bound i with a box (center, half size)
+	void setBox(size_t i, const glm::vec3& center, const glm::vec3& extent) {
+		centerX[i] = center.x; centerY[i] = center.y; centerZ[i] = center.z;
+		extentX[i] = extent.x; extentY[i] = extent.y; extentZ[i] = extent.z;
+		radius[i] = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+	}
+	void addBox(const glm::vec3& low, const glm::vec3& high) {
+		glm::vec3 center = (low + high) * 0.5f, extent = (high - low) * 0.5f;
+		centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+		extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+		radius.push_back(std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z));
+	}
+};
+
+
+
+//signed distance of a point to a plane, summed in the order of the SSE kernels: (x*a + y*b) + (z*c + w).
+//the scalar and SSE results then only differ if the compiler contracts the scalar multiply-adds into FMA,
+//and then only for bounds that touch a plane within rounding
+inline float planeDistance(const glm::vec4& plane, float x, float y, float z) {
+	return (plane.x * x + plane.y * y) + (plane.z * z + plane.w);
+}
+
+//one bound at a time (reference for the SSE kernels, and the tail of their batches)
+inline size_t cullSpheresScalar(const Frustum& frustum, const CullBounds& bounds, unsigned char* visible, size_t first = 0) {
+	size_t count = 0;
+	for (size_t i = first; i < bounds.size(); i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = planeDistance(plane, bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+			inside = distance >= -bounds.radius[i];
+		}
+		visible[i] = inside;
+		count += inside;
+	}
+	return count;
+}
+
+//box: the corner farthest along the plane normal decides (center distance + extent projected on |normal|)
+inline size_t cullBoxesScalar(const Frustum& frustum, const CullBounds& bounds, unsigned char* visible, size_t first = 0) {
+	size_t count = 0;
+	for (size_t i = first; i < bounds.size(); i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = planeDistance(plane, bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+			float reach = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] + std::fabs(plane.z) * bounds.extentZ[i];
+			inside = distance + reach >= 0.0f;
+		}
+		visible[i] = inside;
+		count += inside;
+	}
+	return count;
+}
+
+
+//visible[i] = 1 if sphere i intersects the frustum, 0 if it is completely outside. returns the visible count
+inline size_t cullSpheres(const Frustum& frustum, const CullBounds& bounds, unsigned char* visible) {
+#ifdef FRUSTUM_SSE
+	size_t count = 0, batchEnd = bounds.size() & ~(size_t)3;
+	for (size_t i = 0; i < batchEnd; i += 4) {
+		__m128 x = _mm_loadu_ps(&bounds.centerX[i]), y = _mm_loadu_ps(&bounds.centerY[i]), z = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++) {
+			visible[i + k] = !((mask >> k) & 1);
+			count += visible[i + k];
+		}
+	}
+	return count + cullSpheresScalar(frustum, bounds, visible, batchEnd);
+#else
+	return cullSpheresScalar(frustum, bounds, visible);
+#endif
+}
+
+//the same for the boxes (tighter than the spheres for long, thin objects)
+inline size_t cullBoxes(const Frustum& frustum, const CullBounds& bounds, unsigned char* visible) {
+#ifdef FRUSTUM_SSE
+	size_t count = 0, batchEnd = bounds.size() & ~(size_t)3;
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (size_t i = 0; i < batchEnd; i += 4) {
+		__m128 x = _mm_loadu_ps(&bounds.centerX[i]), y = _mm_loadu_ps(&bounds.centerY[i]), z = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&bounds.extentX[i]), ey = _mm_loadu_ps(&bounds.extentY[i]), ez = _mm_loadu_ps(&bounds.extentZ[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx), _mm_mul_ps(y, ny)), _mm_add_ps(_mm_mul_ps(z, nz), _mm_set1_ps(plane.w)));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_andnot_ps(signMask, nx)), _mm_mul_ps(ey, _mm_andnot_ps(signMask, ny))),
+				_mm_mul_ps(ez, _mm_andnot_ps(signMask, nz)));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++) {
+			visible[i + k] = !((mask >> k) & 1);
+			count += visible[i + k];
+		}
+	}
+	return count + cullBoxesScalar(frustum, bounds, visible, batchEnd);
+#else
+	return cullBoxesScalar(frustum, bounds, visible);
+#endif
+}
+#endif // !FRUSTUM_H
@@ -0,0 +1,136 @@
+/*GL state cache.
+* glUseProgram/glBindVertexArray/glActiveTexture/glBindTexture with the object that is already bound
+* still cost a driver call (and often a validation pass), and the render loops issue a lot of them.
+* GLState remembers what is bound and only forwards the calls that change something.
+* For this to be correct, every bind of these objects has to go through GLState
+* (or call invalidate() after binding behind its back).*/
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+#include <iostream>
+
+//the kinds of calls GLState filters
+enum GLState_Call {
+	CALL_USE_PROGRAM,
+	CALL_BIND_VERTEX_ARRAY,
+	CALL_ACTIVE_TEXTURE,
+	CALL_BIND_TEXTURE,
+	CALL_KIND_COUNT
+};
+
+class GLState
+{
+public:
+	static const unsigned int MAX_UNITS = 32; //texture units tracked for GL_TEXTURE_2D
+
+	//calls forwarded to GL / dropped because they wouldn't change anything
+	struct Counters {
+		unsigned int issued[CALL_KIND_COUNT];
+		unsigned int filtered[CALL_KIND_COUNT];
+	};
+
+	//one state cache per process (there is one GL context)
+	static GLState& instance() {
+		static GLState state;
+		return state;
+	}
+
+	void useProgram(GLuint program) {
+		if (program == currentProgram) { frame.filtered[CALL_USE_PROGRAM]++; return; }
+		glUseProgram(program);
+		currentProgram = program;
+		frame.issued[CALL_USE_PROGRAM]++;
+	}
+
+	void bindVertexArray(GLuint vertexArray) {
+		if (vertexArray == currentVertexArray) { frame.filtered[CALL_BIND_VERTEX_ARRAY]++; return; }
+		glBindVertexArray(vertexArray);
+		currentVertexArray = vertexArray;
+		frame.issued[CALL_BIND_VERTEX_ARRAY]++;
+	}
+
+	//unit: GL_TEXTURE0 + n, like glActiveTexture
+	void activeTexture(GLenum unit) {
+		if (unit == currentUnit) { frame.filtered[CALL_ACTIVE_TEXTURE]++; return; }
+		glActiveTexture(unit);
+		currentUnit = unit;
+		frame.issued[CALL_ACTIVE_TEXTURE]++;
+	}
+
+	//bind on the active unit, like glBindTexture (only GL_TEXTURE_2D bindings are tracked)
+	void bindTexture(GLenum target, GLuint texture) {
+		unsigned int unit = currentUnit - GL_TEXTURE0;
+		if (target != GL_TEXTURE_2D || unit >= MAX_UNITS) {
+			glBindTexture(target, texture);
+			frame.issued[CALL_BIND_TEXTURE]++;
+			return;
+		}
+		if (texture == boundTextures[unit]) { frame.filtered[CALL_BIND_TEXTURE]++; return; }
+		glBindTexture(target, texture);
+		boundTextures[unit] = texture;
+		frame.issued[CALL_BIND_TEXTURE]++;
+	}
+
+	//bind a 2D texture to a unit (switches the active unit only if the binding changes)
+	void bindTextureUnit(unsigned int unit, GLuint texture) {
+		if (unit < MAX_UNITS && boundTextures[unit] == texture) { frame.filtered[CALL_BIND_TEXTURE]++; return; }
+		activeTexture(GL_TEXTURE0 + unit);
+		bindTexture(GL_TEXTURE_2D, texture);
+	}
+
+	//GL unbinds deleted objects, so must we (a new object may get the same name)
+	void programDeleted(GLuint program) { if (currentProgram == program) currentProgram = 0; }
+	void vertexArrayDeleted(GLuint vertexArray) { if (currentVertexArray == vertexArray) currentVertexArray = 0; }
+	void textureDeleted(GLuint texture) {
+		for (unsigned int i = 0; i < MAX_UNITS; i++) if (boundTextures[i] == texture) boundTextures[i] = 0;
+	}
+
+	//forget everything (after code that binds without GLState)
+	void invalidate() {
+		currentProgram = INVALID;
+		currentVertexArray = INVALID;
+		currentUnit = INVALID;
+		for (unsigned int i = 0; i < MAX_UNITS; i++) boundTextures[i] = INVALID;
+	}
+
+	//call at the start of every frame: the counters of the finished frame move to lastFrame()
+	void beginFrame() {
+		previous = frame;
+		resetCounters(frame);
+	}
+
+	const Counters& lastFrame() const { return previous; }
+
+	void printFrameStats() const {
+		const char* names[CALL_KIND_COUNT] = { "glUseProgram", "glBindVertexArray", "glActiveTexture", "glBindTexture" };
+		std::cout << "GL state calls last frame (issued/filtered):";
+		for (unsigned int i = 0; i < CALL_KIND_COUNT; i++) std::cout << " " << names[i] << " " << previous.issued[i] << "/" << previous.filtered[i];
+		std::cout << std::endl;
+	}
+
+
+
+private:
+	static const GLuint INVALID = 0xFFFFFFFFu; //"unknown", never equal to a real binding
+
+	GLuint currentProgram;
+	GLuint currentVertexArray;
+	GLenum currentUnit;
+	GLuint boundTextures[MAX_UNITS];
+	Counters frame, previous;
+
+	GLState() {
+		invalidate();
+		resetCounters(frame);
+		resetCounters(previous);
+	}
+	GLState(const GLState&) = delete;
+	GLState& operator=(const GLState&) = delete;
+
+	static void resetCounters(Counters& counters) {
+		for (unsigned int i = 0; i < CALL_KIND_COUNT; i++) counters.issued[i] = counters.filtered[i] = 0;
+	}
+};
+#endif // !GL_STATE_H
@@ -0,0 +1,101 @@
+/*Per-instance model matrices for instanced drawing.
+* The cube demos set "model" and call glDrawArrays once per cube: one uniform upload + one draw call per object.
+* InstanceBuffer keeps the model matrices of all instances in a vertex buffer and feeds them to the vertex shader
+* as a mat4 attribute that advances once per instance (divisor 1), so the whole field is one glDrawArraysInstanced.
+* shader side:
+*   layout (location = 3) in mat4 aInstanceModel;   (a mat4 takes 4 locations: 3..6)
+*   uniform bool instanced;                          (false: the "model" uniform is used like before)
+* A field that moves every frame can skip the upload: stream() writes the matrices into a persistently mapped
+* StreamBuffer and points the attribute there (no orphaning, no reallocation).*/
+
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstring>
+
+#include "StreamBuffer.h"
+
+const unsigned int INSTANCE_MODEL_LOCATION = 3; //first attribute location of the instance matrix
+
+class InstanceBuffer
+{
+public:
+	unsigned int VBO;
+	unsigned int count;    //instances drawn by draw()
+	unsigned int capacity; //instances the buffer has storage for
+
+	InstanceBuffer() : count(0), capacity(0), location(INSTANCE_MODEL_LOCATION), streamBuffer(0), streamOffset(0) { glGenBuffers(1, &VBO); }
+	~InstanceBuffer() { glDeleteBuffers(1, &VBO); }
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+	//add the instance matrix to the currently bound VAO
+	void attach(unsigned int attributeLocation = INSTANCE_MODEL_LOCATION) {
+		location = attributeLocation;
+		point(VBO, 0);
+		//a mat4 attribute is 4 vec4 attributes, one per column
+		for (unsigned int column = 0; column < 4; column++) {
+			glEnableVertexAttribArray(location + column);
+			glVertexAttribDivisor(location + column, 1); //next matrix per instance, not per vertex
+		}
+	}
+
+	//replace the instance matrices (call once for a static field, every frame for a moving one)
+	//(after stream(): the VAO of attach() must be bound, the attribute goes back to VBO)
+	void upload(const glm::mat4* transforms, unsigned int instanceCount) {
+		if (streamBuffer) point(VBO, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (instanceCount > capacity) {
+			glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(glm::mat4), transforms, GL_DYNAMIC_DRAW);
+			capacity = instanceCount;
+		}
+		else {
+			//orphan the old storage first: the GPU may still be reading last frame's matrices
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(glm::mat4), transforms);
+		}
+		count = instanceCount;
+	}
+	void upload(const std::vector<glm::mat4>& transforms) {
+		upload(transforms.empty() ? nullptr : &transforms[0], (unsigned int)transforms.size());
+	}
+
+	//this frame's matrices, written into the current region of a stream buffer (between its beginFrame() and endFrame()).
+	//the VAO of attach() must be bound: the attribute is pointed at the region. false if the region is full (nothing drawn)
+	bool stream(StreamBuffer& buffer, const glm::mat4* transforms, unsigned int instanceCount) {
+		GLintptr offset = 0;
+		void* target = buffer.allocate(instanceCount * sizeof(glm::mat4), sizeof(glm::vec4), offset);
+		if (!target) {
+			count = 0;
+			return false;
+		}
+		if (instanceCount) memcpy(target, transforms, instanceCount * sizeof(glm::mat4));
+		buffer.flush();
+		if (streamBuffer != buffer.buffer || streamOffset != offset) point(buffer.buffer, offset);
+		count = instanceCount;
+		return true;
+	}
+
+	//draw every instance with the vertices [first, first + vertexCount) of the bound VAO
+	void draw(GLenum mode, GLint first, GLsizei vertexCount) const {
+		if (count) glDrawArraysInstanced(mode, first, vertexCount, (GLsizei)count);
+	}
+
+private:
+	unsigned int location;   //first attribute location (attach())
+	GLuint streamBuffer;     //buffer the attribute reads from when it isn't VBO (stream()), 0: VBO
+	GLintptr streamOffset;
+
+	//the instance matrix attribute of the bound VAO reads from buffer at offset
+	void point(GLuint buffer, GLintptr offset) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (unsigned int column = 0; column < 4; column++)
+			glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+		streamBuffer = buffer == VBO ? 0 : buffer;
+		streamOffset = offset;
+	}
+};
+#endif // !INSTANCE_BUFFER_H
@@ -0,0 +1,329 @@
+/*KTX2 container for block compressed textures (written by BakeTexture, read by the texture loaders).
+* A KTX2 file holds the texture as the GPU samples it: the vkFormat of the blocks and every mip level, precomputed.
+* Loading is a file read and one glCompressedTexImage2D per level: no png/jpg decompression, no glGenerateMipmap.
+* Only what BakeTexture writes is read back: 2D, one layer, one face, no supercompression,
+* vkFormat BC1 RGB / BC3 / BC5 / BC7 / ETC2 RGB (UNORM or SRGB).
+* Where the GL can't sample the format, uploadKTX2() decodes the levels on the CPU (BlockCompression.h) and uploads RGBA8:
+* it still skips the png decode and the mip generation, but the texture takes the full RGBA8 VRAM.
+* (desktop drivers accept ETC2 since GL 4.3 but often decode it to RGBA8 themselves, then it saves nothing in VRAM)
+* The KTXorientation key records the row order: "rd" rows top to bottom like the source image, "ru" flipped bottom to top
+* like stb_image with stbi_set_flip_vertically_on_load(true).*/
+
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <glad/glad.h>
+#include "BlockCompression.h"
+#include "GLState.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+struct KTX2Image {
+	Block_Format format;
+	bool srgb;    //the colors are sRGB encoded (an SRGB vkFormat)
+	bool flipped; //KTXorientation "ru": the first row is the bottom one
+	std::string source; //"x9source": file name of the image it was baked from (empty: not recorded, e.g. another tool's file)
+	int width, height;
+	std::vector<std::vector<unsigned char>> levels; //mip levels, 0 = full size
+};
+
+//vkFormat of a block format (VkFormat enum values of the Vulkan spec)
+inline uint32_t ktx2VkFormat(Block_Format format, bool srgb) {
+	switch (format) {
+	case BLOCK_BC1: return srgb ? 132 : 131;  //VK_FORMAT_BC1_RGB_SRGB/UNORM_BLOCK
+	case BLOCK_BC3: return srgb ? 138 : 137;  //VK_FORMAT_BC3_*
+	case BLOCK_BC5: return 141;               //VK_FORMAT_BC5_UNORM_BLOCK (no sRGB variant)
+	case BLOCK_BC7: return srgb ? 146 : 145;  //VK_FORMAT_BC7_*
+	case BLOCK_ETC2: return srgb ? 148 : 147; //VK_FORMAT_ETC2_R8G8B8_*
+	}
+	return 0;
+}
+
+//the reverse, false for a format the loader doesn't handle
+inline bool ktx2BlockFormat(uint32_t vkFormat, Block_Format& format, bool& srgb) {
+	srgb = false;
+	switch (vkFormat) {
+	case 132: srgb = true; //fall through
+	case 131: format = BLOCK_BC1; return true;
+	case 138: srgb = true; //fall through
+	case 137: format = BLOCK_BC3; return true;
+	case 141: format = BLOCK_BC5; return true;
+	case 146: srgb = true; //fall through
+	case 145: format = BLOCK_BC7; return true;
+	case 148: srgb = true; //fall through
+	case 147: format = BLOCK_ETC2; return true;
+	}
+	return false;
+}
+
+//number of levels of a full mip chain (down to 1x1)
+inline int ktx2LevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+	}
+	return levels;
+}
+
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct KTX2Header {
+	unsigned char identifier[12];
+	uint32_t vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount, supercompressionScheme;
+	uint32_t dfdByteOffset, dfdByteLength, kvdByteOffset, kvdByteLength;
+	uint64_t sgdByteOffset, sgdByteLength;
+};
+struct KTX2LevelIndex {
+	uint64_t byteOffset, byteLength, uncompressedByteLength;
+};
+
+//data format descriptor: one basic block, one sample per 64 bit half block (channel ids of the Khronos data format spec)
+inline std::vector<uint32_t> ktx2Descriptor(Block_Format format, bool srgb) {
+	struct Sample { uint32_t offset, bits, channel; };
+	Sample samples[2];
+	uint32_t model, count = 1;
+	switch (format) {
+	case BLOCK_BC1: model = 128; samples[0] = { 0, 64, 0 }; break;                                //BC1A, color
+	case BLOCK_BC3: model = 130; samples[0] = { 0, 64, 15 | 0x10 }; samples[1] = { 64, 64, 0 }; count = 2; break; //BC3: alpha (linear), color
+	case BLOCK_BC5: model = 132; samples[0] = { 0, 64, 0 }; samples[1] = { 64, 64, 1 }; count = 2; break;        //BC5: red, green
+	case BLOCK_BC7: model = 134; samples[0] = { 0, 128, 0 }; break;                               //BC7, color
+	default: model = 161; samples[0] = { 0, 64, 2 }; break;                                       //ETC2, color
+	}
+	std::vector<uint32_t> words;
+	words.push_back(4 + 24 + 16 * count);                  //dfdTotalSize
+	words.push_back(0);                                    //vendor Khronos, type basic
+	words.push_back(2 | ((24 + 16 * count) << 16));        //version 2, block size
+	words.push_back(model | (1 << 8) | ((srgb ? 2u : 1u) << 16)); //model, BT709 primaries, sRGB/linear transfer, straight alpha
+	words.push_back(3 | (3 << 8));                         //4x4 texel blocks (dimensions - 1)
+	words.push_back(blockBytes(format));                   //bytes of plane 0
+	words.push_back(0);
+	for (uint32_t i = 0; i < count; i++) {
+		words.push_back(samples[i].offset | ((samples[i].bits - 1) << 16) | (samples[i].channel << 24));
+		words.push_back(0);           //sample position
+		words.push_back(0);           //lower
+		words.push_back(0xFFFFFFFFu); //upper
+	}
+	return words;
+}
+
+inline void ktx2AppendKeyValue(std::vector<unsigned char>& out, const std::string& key, const std::string& value) {
+	uint32_t length = (uint32_t)(key.size() + 1 + value.size() + 1);
+	const unsigned char* bytes = (const unsigned char*)&length;
+	out.insert(out.end(), bytes, bytes + 4);
+	out.insert(out.end(), key.c_str(), key.c_str() + key.size() + 1);
+	out.insert(out.end(), value.c_str(), value.c_str() + value.size() + 1);
+	while (out.size() % 4) out.push_back(0);
+}
+
+inline bool writeKTX2(const std::string& path, const KTX2Image& image) {
+	uint32_t levelCount = (uint32_t)image.levels.size();
+	std::vector<uint32_t> dfd = ktx2Descriptor(image.format, image.srgb);
+	std::vector<unsigned char> kvd;
+	ktx2AppendKeyValue(kvd, "KTXorientation", image.flipped ? "ru" : "rd"); //(keys sorted by their bytes)
+	ktx2AppendKeyValue(kvd, "KTXwriter", "BakeTexture");
+	if (!image.source.empty()) ktx2AppendKeyValue(kvd, "x9source", image.source);
+
+	KTX2Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.identifier, KTX2_IDENTIFIER, 12);
+	header.vkFormat = ktx2VkFormat(image.format, image.srgb);
+	header.typeSize = 1;
+	header.pixelWidth = (uint32_t)image.width;
+	header.pixelHeight = (uint32_t)image.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = (uint32_t)(sizeof(KTX2Header) + levelCount * sizeof(KTX2LevelIndex));
+	header.dfdByteLength = (uint32_t)(dfd.size() * 4);
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = (uint32_t)kvd.size();
+
+	//the level data: smallest level first, every level aligned to the block size
+	std::vector<KTX2LevelIndex> index(levelCount);
+	uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (int level = (int)levelCount - 1; level >= 0; level--) {
+		offset = (offset + blockBytes(image.format) - 1) / blockBytes(image.format) * blockBytes(image.format);
+		index[level].byteOffset = offset;
+		index[level].byteLength = index[level].uncompressedByteLength = image.levels[level].size();
+		offset += image.levels[level].size();
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)index.data(), index.size() * sizeof(KTX2LevelIndex));
+	out.write((const char*)dfd.data(), dfd.size() * 4);
+	out.write((const char*)kvd.data(), kvd.size());
+	uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+	for (int level = (int)levelCount - 1; level >= 0; level--) {
+		static const char padding[16] = {};
+		out.write(padding, index[level].byteOffset - written);
+		out.write((const char*)image.levels[level].data(), image.levels[level].size());
+		written = index[level].byteOffset + index[level].byteLength;
+	}
+	if (!out) {
+		std::cout << "(KTX2.h)★ERROR::cannot write " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//firstLevel: the levels above it are left empty (the small ones come first in the file: a texture streamer reads the tail first)
+inline bool readKTX2(const std::string& path, KTX2Image& image, uint32_t firstLevel = 0) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		std::cout << "(KTX2.h)★ERROR::cannot open " << path << std::endl;
+		return false;
+	}
+	KTX2Header header;
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.identifier, KTX2_IDENTIFIER, 12) != 0) {
+		std::cout << "(KTX2.h)★ERROR::" << path << " is not a KTX2 file" << std::endl;
+		return false;
+	}
+	if (!ktx2BlockFormat(header.vkFormat, image.format, image.srgb) || header.supercompressionScheme != 0 || header.pixelDepth > 1
+		|| header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+		std::cout << "(KTX2.h)★ERROR::" << path << ": unsupported KTX2 texture (vkFormat " << header.vkFormat
+			<< ", supercompression " << header.supercompressionScheme << ")" << std::endl;
+		return false;
+	}
+	image.width = (int)header.pixelWidth;
+	image.height = (int)header.pixelHeight;
+	uint32_t levelCount = header.levelCount ? header.levelCount : 1; //(0: "generate the mips", only level 0 is stored)
+	std::vector<KTX2LevelIndex> index(levelCount);
+	in.read((char*)index.data(), levelCount * sizeof(KTX2LevelIndex));
+
+	image.flipped = false;
+	image.source.clear();
+	std::vector<char> kvd(header.kvdByteLength);
+	if (header.kvdByteLength && in.seekg(header.kvdByteOffset) && in.read(kvd.data(), kvd.size())) {
+		for (size_t at = 0; at + 4 <= kvd.size();) {
+			uint32_t length;
+			memcpy(&length, &kvd[at], 4);
+			if (length == 0 || at + 4 + length > kvd.size()) break;
+			std::string key(&kvd[at + 4], strnlen(&kvd[at + 4], length));
+			if (key == "KTXorientation" && key.size() + 1 < length) image.flipped = kvd[at + 4 + key.size() + 1 + 1] == 'u';
+			if (key == "x9source" && key.size() + 1 < length) {
+				const char* value = &kvd[at + 4 + key.size() + 1];
+				image.source.assign(value, strnlen(value, length - key.size() - 1));
+			}
+			at += (4 + length + 3) & ~(size_t)3;
+		}
+	}
+
+	image.levels.resize(levelCount);
+	int width = image.width, height = image.height;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		if (index[level].byteLength != compressedSize(image.format, width, height)) {
+			std::cout << "(KTX2.h)★ERROR::" << path << ": level " << level << " has the wrong size" << std::endl;
+			return false;
+		}
+		if (level < firstLevel) {
+			image.levels[level].clear();
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			continue;
+		}
+		image.levels[level].resize((size_t)index[level].byteLength);
+		in.seekg((std::streamoff)index[level].byteOffset);
+		if (!in.read((char*)image.levels[level].data(), image.levels[level].size())) {
+			std::cout << "(KTX2.h)★ERROR::" << path << " is truncated" << std::endl;
+			return false;
+		}
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return true;
+}
+
+
+
+//GL internal format of a block format (0: no compressed format with sRGB decoding for it, see uploadKTX2)
+inline GLenum ktx2GLFormat(Block_Format format, bool srgb) {
+	switch (format) {
+	case BLOCK_BC1: return srgb ? 0x8C4C : 0x83F0;  //GL_COMPRESSED_SRGB_S3TC_DXT1_EXT / GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	case BLOCK_BC3: return srgb ? 0x8C4F : 0x83F3;  //GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT / GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	case BLOCK_BC5: return srgb ? 0 : 0x8DBD;       //GL_COMPRESSED_RG_RGTC2
+	case BLOCK_BC7: return srgb ? 0x8E8D : 0x8E8C;  //GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM / GL_COMPRESSED_RGBA_BPTC_UNORM
+	case BLOCK_ETC2: return srgb ? 0x9275 : 0x9274; //GL_COMPRESSED_SRGB8_ETC2 / GL_COMPRESSED_RGB8_ETC2
+	}
+	return 0;
+}
+
+inline bool hasGLExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+		if (extension && strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
+
+//can the GL sample the format directly (asked once per format and process)
+inline bool compressedFormatSupported(Block_Format format, bool srgb) {
+	static int supported[5][2] = { { -1, -1 }, { -1, -1 }, { -1, -1 }, { -1, -1 }, { -1, -1 } };
+	int& answer = supported[format][srgb ? 1 : 0];
+	if (answer >= 0) return answer == 1;
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	int version = major * 10 + minor;
+	bool result = false;
+	switch (format) {
+	case BLOCK_BC1:
+	case BLOCK_BC3:
+		result = hasGLExtension("GL_EXT_texture_compression_s3tc")
+			&& (!srgb || hasGLExtension("GL_EXT_texture_sRGB") || hasGLExtension("GL_EXT_texture_compression_s3tc_srgb"));
+		break;
+	case BLOCK_BC5: result = !srgb && version >= 30; break;
+	case BLOCK_BC7: result = version >= 42 || hasGLExtension("GL_ARB_texture_compression_bptc"); break;
+	case BLOCK_ETC2: result = version >= 43 || hasGLExtension("GL_ARB_ES3_compatibility"); break;
+	}
+	answer = result ? 1 : 0;
+	return result;
+}
+
+//create a texture from a KTX2 image. gamma: sample it as sRGB (like uploadTexture's gamma).
+//allowCompressed false: always take the CPU decode path (to compare it, or to test it on a GL that has the format)
+inline unsigned int uploadKTX2(const KTX2Image& image, bool gamma = false, bool allowCompressed = true) {
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+	GLint levelCount = (GLint)image.levels.size();
+	//(BC5 has no sRGB format: it holds normals/data, gamma doesn't apply)
+	bool srgb = gamma && image.format != BLOCK_BC5;
+	GLenum internalFormat = ktx2GLFormat(image.format, srgb);
+
+	int width = image.width, height = image.height;
+	if (allowCompressed && internalFormat && compressedFormatSupported(image.format, srgb)) {
+		for (GLint level = 0; level < levelCount; level++) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, (GLsizei)image.levels[level].size(), image.levels[level].data());
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+	else {
+		std::vector<unsigned char> rgba((size_t)width * height * 4);
+		GLenum uploadFormat = image.format == BLOCK_BC5 ? GL_RG8 : (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		for (GLint level = 0; level < levelCount; level++) {
+			decompressImage(image.format, image.levels[level].data(), width, height, rgba.data());
+			glTexImage2D(GL_TEXTURE_2D, level, uploadFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+	//the file's mips are used as they are, a file without them samples level 0 only
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+}
+#endif // !KTX2_H
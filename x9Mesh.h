@@ -10,8 +10,12 @@
 #define MESH_H
 
 #include "Shader.h"
+#include "GLState.h"
+#include <glm/gtc/packing.hpp>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <algorithm>
 using namespace std;
 
 //store each of the vertex attribute in a struct.
@@ -28,6 +32,44 @@ struct Vertex {
 	glm::vec3 Bitangent;
 };
 
+//vertex layout of the GPU buffers
+enum Vertex_Format {
+	VERTEX_FULL,   //struct Vertex as it is (56 bytes)
+	VERTEX_PACKED  //struct PackedVertex (24 bytes)
+};
+
+/*Quantized vertex for large models: 24 instead of 56 bytes in VRAM and per vertex fetch.
+* Position stays 3 floats (scanned models need the precision),
+* normal/tangent are signed normalized 10:10:10:2 (GL_INT_2_10_10_10_REV, ~0.1 degree steps),
+* the tangent's 2 bit w is the bitangent's sign (bitangent = cross(normal, tangent) * sign(w)),
+* UVs are half floats.
+* The shader inputs don't change: vec3 aNormal / vec2 aTexCoords / vec4 aTangent are unpacked by the vertex fetch.*/
+struct PackedVertex {
+	glm::vec3 Position;
+	uint32_t Normal;     //snorm 10:10:10:2, w unused
+	uint32_t Tangent;    //snorm 10:10:10:2, w = bitangent sign
+	uint32_t TexCoords;  //2 half floats
+};
+
+inline PackedVertex packVertex(const Vertex& vertex) {
+	PackedVertex packed;
+	packed.Position = vertex.Position;
+	packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+	//(tangent frames may be mirrored on UV seams, only the sign of the bitangent is needed to rebuild it)
+	float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+	packed.Tangent = glm::packSnorm3x10_1x2(glm::vec4(vertex.Tangent, handedness));
+	packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+	return packed;
+}
+
+inline void packVertices(const Vertex* vertices, size_t count, vector<PackedVertex>& packed) {
+	packed.resize(count);
+	for (size_t i = 0; i < count; i++) packed[i] = packVertex(vertices[i]);
+}
+
+//bytes per vertex in the GPU buffer
+inline size_t vertexSize(Vertex_Format format) { return format == VERTEX_PACKED ? sizeof(PackedVertex) : sizeof(Vertex); }
+
 //store texture's id and its type(diffuse or specular).
 //Optimaization 
 //to saving a lot of processing power, 
@@ -38,6 +80,13 @@ struct Texture {
 	string path; //we store the path of the texture to compare with other textures
 };
 
+//one level of detail of a mesh: a range of its indices (see MeshSimplifier.h)
+struct MeshLOD {
+	unsigned int firstIndex; //relative to the mesh's firstIndex
+	unsigned int indexCount;
+	float error;             //geometric error of the level in model units (0 for the full mesh)
+};
+
 
 
 
@@ -53,22 +102,185 @@ public:
 	vector<unsigned int> indices;
 	vector<Texture> textures;
 	unsigned int VAO;
+	//range of the mesh inside its (possibly shared) vertex/index buffers
+	int baseVertex;          //added to every index: first vertex of the mesh in the VBO
+	unsigned int firstIndex; //first index of the mesh in the EBO
+	unsigned int indexCount; //number of indices (indices may be empty for meshes uploaded from a baked file)
+	Vertex_Format format;    //layout of the uploaded vertices (vertices keeps the full ones)
+	//levels of detail, finest first (empty: only the full mesh). indexCount is the count of level 0
+	vector<MeshLOD> lods;
+	unsigned int node;              //scene graph node that places the mesh (Model::nodes, folded into "model" by Model::Draw)
+	//bounds in mesh space (LOD selection, frustum culling)
+	glm::vec3 boundsMin, boundsMax; //axis aligned box
+	glm::vec3 boundsCenter;         //sphere
+	float boundsRadius;
 
 	//constructor <- give the mesh all the necessary data
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
+	//upload = false: the owner (Model's geometry arena) puts the data into shared buffers and sets VAO/baseVertex/firstIndex
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool upload = true, Vertex_Format format = VERTEX_FULL) {
 		//lists of all required mesh data that I can use for rendering
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
+		VAO = VBO = EBO = 0;
+		baseVertex = 0;
+		firstIndex = 0;
+		indexCount = (unsigned int)this->indices.size();
+		this->format = format;
+		node = 0;
+		computeBounds(this->vertices.empty() ? nullptr : &this->vertices[0], this->vertices.size());
 
 		//set the vertex buffers and its attribute pointers.
-		setupMesh();
+		if (upload) setupMesh();
+	}
+
+	//constructor for a mesh that is only a range of buffers someone else already filled (a memory mapped baked model).
+	//no CPU copy is kept.
+	Mesh(vector<Texture> textures, unsigned int VAO, int baseVertex, unsigned int firstIndex, unsigned int indexCount, Vertex_Format format = VERTEX_FULL) {
+		this->textures = textures;
+		this->format = format;
+		this->VAO = VAO;
+		this->baseVertex = baseVertex;
+		this->firstIndex = firstIndex;
+		this->indexCount = indexCount;
+		VBO = EBO = 0;
+		node = 0;
+		boundsMin = boundsMax = boundsCenter = glm::vec3(0.0f);
+		boundsRadius = 0.0f;
+	}
+
+	//use an LOD chain whose coarser levels follow level 0 in indices (generateLODs())
+	void setLODs(const vector<MeshLOD>& levels) {
+		lods = levels;
+		if (!lods.empty()) indexCount = lods[0].indexCount;
+	}
+
+	unsigned int lodCount() const { return lods.empty() ? 1 : (unsigned int)lods.size(); }
+	unsigned int lodIndexCount(unsigned int lod) const { return lod < lods.size() ? lods[lod].indexCount : indexCount; }
+	unsigned int lodFirstIndex(unsigned int lod) const { return firstIndex + (lod < lods.size() ? lods[lod].firstIndex : 0); }
+
+	//bounding box of the vertices and a sphere around them (center of the box, radius to the farthest vertex)
+	void computeBounds(const Vertex* data, size_t count) {
+		boundsMin = boundsMax = boundsCenter = glm::vec3(0.0f);
+		boundsRadius = 0.0f;
+		if (count == 0) return;
+		glm::vec3 low = data[0].Position, high = data[0].Position;
+		for (size_t i = 1; i < count; i++) {
+			low = glm::min(low, data[i].Position);
+			high = glm::max(high, data[i].Position);
+		}
+		boundsMin = low;
+		boundsMax = high;
+		boundsCenter = (low + high) * 0.5f;
+		for (size_t i = 0; i < count; i++) boundsRadius = std::max(boundsRadius, glm::length(data[i].Position - boundsCenter));
 	}
 	
 	//finally draw the mesh
 	/*★by passing the shader to the mesh we can set several uniforms before drawing.
-		(like linking samplers to texture units)*/
-	void Draw(Shader shader) {
+		(like linking samplers to texture units)
+	* (by reference: a copy would duplicate the shader's uniform table every draw)
+	* the mesh is drawn at the "model" matrix the caller set: node is only applied by Model::Draw*/
+	void Draw(Shader& shader) {
+		bindTextures(shader);
+
+		//draw mesh
+		//(no unbinding/resetting afterwards: all binds go through GLState, the next draw binds what it needs)
+		GLState::instance().bindVertexArray(VAO);
+		drawElements();
+	}
+
+	//bind the textures to the units of their texture_xxxN samplers
+	//(no strings, no allocations and no glUniform per frame: the units are resolved, and the samplers set, once per shader program)
+	void bindTextures(Shader& shader) {
+		const vector<GLint>& units = samplerUnits(shader);
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			//bind the texture to its sampler's unit (skipped if it's already bound there, or the shader has no such sampler)
+			if (units[i] >= 0) GLState::instance().bindTextureUnit(units[i], textures[i].id);
+		}
+	}
+
+	//issue the draw call for this mesh's range, or one of its levels of detail (the VAO must already be bound)
+	void drawElements(unsigned int lod = 0) const {
+		glDrawElementsBaseVertex(GL_TRIANGLES, lodIndexCount(lod), GL_UNSIGNED_INT, (void*)(lodFirstIndex(lod) * sizeof(unsigned int)), baseVertex);
+	}
+
+	//declare the Vertex/PackedVertex layout for the currently bound VAO + GL_ARRAY_BUFFER
+	//(shared by setupMesh and Model's geometry arena)
+	static void setupVertexAttributes(Vertex_Format format = VERTEX_FULL) {
+		if (format == VERTEX_PACKED) {
+			setupPackedVertexAttributes();
+			return;
+		}
+		//vertex position
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		/*parameter
+		* 1: which vertex attribute.
+		*    we specified the location of position vertex attribute in the vertex shader
+		*    with [[[ layout (location = 0) ]]]
+		*    set the location of the vertex attribute to 0
+		*    since we want to pass data to this vertex attribute, we pass in 0.
+		*
+		* 2: the size of the vertex attribute.
+		*    The vertex attributes is a [[[ vec3 ]]] so if is composed of 3 values.
+		*
+		* 3: the type of the data
+		*    GL_FLOAT (a vec* in GLSL consists of floating point values)
+		*
+		* 4: whether if we want the data to be normalized
+		*    GL_TRUE -- the integer data is normalized to 0(or -1) and 1 when converted to float.
+		*
+		* 5: stride (the space between consecutive vertex attributes)
+		*	 --this time,set the stride to Vertex struct's size.
+		*
+		* 6: the offset of where the position data begins in the buffer
+		*/
+		//vertex normals
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		/* parameter6 == 12byte(3 float * 4 byte)
+		* (to set the byte offset of the normal vector equal to the byte offset of the normal attribute in the struct.
+		* * * offset(strct, name--variable name of the struct)
+		* * *   └return the byte offset of that variable from the start of the struct.
+		*/
+		//vertex texture coordinates
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+		//vertex tangent
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+	}
+
+	//the same attribute locations for PackedVertex: normalized = GL_TRUE turns the 10 bit integers back into -1..1
+	static void setupPackedVertexAttributes() {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+	}
+
+
+
+private:
+	//render data
+	unsigned int VBO, EBO;
+
+	//texture unit of each texture for one shader program
+	struct SamplerBinding {
+		unsigned int generation; //Shader::generation of the program (a reloaded program, or a new one that got the same GL name, misses)
+		vector<GLint> units;     //units[i] = unit of the sampler of textures[i] (Shader::samplerUnit()), -1: not in the program
+	};
+	vector<SamplerBinding> samplerBindings; //one entry per program the mesh was drawn with
+
+	//the texture units for this shader program, resolved on the first draw with it (which also sets the samplers)
+	const vector<GLint>& samplerUnits(Shader& shader) {
+		for (unsigned int b = 0; b < samplerBindings.size(); b++)
+			if (samplerBindings[b].generation == shader.generation) return samplerBindings[b].units;
+
 		/*Before rendering the mesh(by calling glDrawElements), bind appropriate textures first
 		* To bind texture, we should know how many textures/what type of textures the mesh has.
 		* A naming convention to set the texture units and samplers in the shaders
@@ -85,9 +297,9 @@ public:
 		unsigned int normalN = 1;
 		unsigned int heightN = 1;
 
+		SamplerBinding binding;
+		binding.generation = shader.generation;
 		for (unsigned int i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i);//active texture unit before binding 
-
 			//retrieve texture number (the N in diffuse_textureN)
 			string number;
 			string name = textures[i].type;
@@ -99,29 +311,13 @@ public:
 			else if (name == "texture_normal") number = std::to_string(normalN++);	   //transfer unsinged int to stream
 			else if (name == "texture_height") number = std::to_string(heightN++);     //transfer unsinged int to stream
 
-			//2.set the sampler to the correct texture unit
-			//locate the sampler, give it the location value to correspond with the currently active texture unit.
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			//and finally bind the texture.
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			//2.the sampler's unit (set on the program the first time any mesh asks for it)
+			binding.units.push_back(shader.samplerUnit(name + number));
 		}
-		glActiveTexture(GL_TEXTURE0);
-
-		//draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
-		//After configuration, set everything back to defaults
-		glActiveTexture(GL_TEXTURE0);
+		samplerBindings.push_back(binding);
+		return samplerBindings.back().units;
 	}
 
-
-
-private:
-	//render data
-	unsigned int VBO, EBO;
-
 	//initialize the buffers
 	//setup the buffers and specify the vertex shader layout via vertex attribute pointers.
 	/*In C++, Structs's property memoray layout is sequential.
@@ -142,58 +338,26 @@ private:
 		glGenBuffers(1, &VBO);
 		glGenBuffers(1, &EBO);
 
-		glBindVertexArray(VAO);
+		GLState::instance().bindVertexArray(VAO);
 
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
 		/*A great thing about structs is that their momory layout is sequential for all its items.
 		The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		again translate to 3/2 float which translate to a byte array*/
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		if (format == VERTEX_PACKED) {
+			vector<PackedVertex> packed;
+			packVertices(&vertices[0], vertices.size(), packed);
+			glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), &packed[0], GL_STATIC_DRAW);
+		}
+		else glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 		//parameter2 == 32 bytes (8 floats * 4 byte each)
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
-		//vertex position
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		/*parameter
-		* 1: which vertex attribute.
-		*    we specified the location of position vertex attribute in the vertex shader
-		*    with [[[ layout (location = 0) ]]]
-		*    set the location of the vertex attribute to 0
-		*    since we want to pass data to this vertex attribute, we pass in 0.
-		*
-		* 2: the size of the vertex attribute.
-		*    The vertex attributes is a [[[ vec3 ]]] so if is composed of 3 values.
-		*
-		* 3: the type of the data
-		*    GL_FLOAT (a vec* in GLSL consists of floating point values)
-		*
-		* 4: whether if we want the data to be normalized
-		*    GL_TRUE -- the integer data is normalized to 0(or -1) and 1 when converted to float.
-		*
-		* 5: stride (the space between consecutive vertex attributes)
-		*	 --this time,set the stride to Vertex struct's size.
-		*
-		* 6: the offset of where the position data begins in the buffer
-		*/
-		//vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-		/* parameter6 == 12byte(3 float * 4 byte)
-		* (to set the byte offset of the normal vector equal to the byte offset of the normal attribute in the struct.
-		* * * offset(strct, name--variable name of the struct)
-		* * *   └return the byte offset of that variable from the start of the struct.
-		*/
-		//vertex texture coordinates
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-		//vertex tangent
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+		setupVertexAttributes(format);
 
-		glBindVertexArray(0);
+		GLState::instance().bindVertexArray(0);
 	}
 //If I want another vertex attribute, I can simply add it to the struct 
 //and due to its flexible nature, the rendering code won't break.
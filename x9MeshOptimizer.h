@@ -0,0 +1,278 @@
+/*Post-load optimization of a mesh's triangle and vertex order.
+* ASSIMP hands the faces over in file order. For scanned meshes that order has almost no locality,
+* so the post-transform vertex cache misses on nearly every vertex (ACMR close to 3).
+* optimizeMesh() runs three passes over a triangle list:
+*   1. vertex cache: Forsyth's greedy reordering (triangles whose vertices are in a simulated LRU cache go first)
+*   2. overdraw: the cache order is cut into clusters at its hard boundaries and the clusters are sorted
+*      so the ones facing away from the mesh center (the outside) are drawn first (Sander et al., "Tipsify").
+*      The result is only kept if the ACMR stays within OVERDRAW_THRESHOLD of pass 1.
+*   3. vertex fetch: vertices are renumbered in the order the indices first use them, so the fetch walks the VBO forward.
+* ACMR = transformed vertices / triangle, ATVR = transformed vertices / vertex (1.0 is optimal),
+* both measured with a FIFO cache of STATS_CACHE_SIZE entries like most hardware has.*/
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+const unsigned int FORSYTH_CACHE_SIZE = 32;    //LRU size the vertex cache pass optimizes for
+const unsigned int STATS_CACHE_SIZE = 16;      //FIFO size of the ACMR/ATVR measurement
+const float OVERDRAW_THRESHOLD = 1.05f;        //ACMR the overdraw pass may cost (x pass 1)
+
+//the passes of optimizeMesh(), in order
+enum MeshOptimizer_Pass {
+	PASS_ORIGINAL,
+	PASS_VERTEX_CACHE,
+	PASS_OVERDRAW,
+	PASS_VERTEX_FETCH,
+	PASS_COUNT
+};
+
+//vertex cache statistics after every pass (add reports of several meshes for a model total)
+struct MeshOptimizer_Report {
+	size_t triangles;
+	size_t vertices;
+	size_t transformed[PASS_COUNT]; //simulated vertex shader invocations
+
+	MeshOptimizer_Report() : triangles(0), vertices(0) {
+		for (unsigned int i = 0; i < PASS_COUNT; i++) transformed[i] = 0;
+	}
+	void add(const MeshOptimizer_Report& other) {
+		triangles += other.triangles;
+		vertices += other.vertices;
+		for (unsigned int i = 0; i < PASS_COUNT; i++) transformed[i] += other.transformed[i];
+	}
+	float acmr(MeshOptimizer_Pass pass) const { return triangles ? (float)transformed[pass] / triangles : 0.0f; }
+	float atvr(MeshOptimizer_Pass pass) const { return vertices ? (float)transformed[pass] / vertices : 0.0f; }
+
+	void print() const {
+		const char* names[PASS_COUNT] = { "original", "vertex cache", "overdraw", "vertex fetch" };
+		std::cout << "mesh optimizer: " << triangles << " triangles, " << vertices << " vertices" << std::endl;
+		for (unsigned int i = 0; i < PASS_COUNT; i++)
+			std::cout << "  " << names[i] << ": ACMR " << acmr((MeshOptimizer_Pass)i) << ", ATVR " << atvr((MeshOptimizer_Pass)i) << std::endl;
+	}
+};
+
+
+
+//vertex shader invocations of an index list with a FIFO post-transform cache
+inline size_t simulateVertexCache(const vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = STATS_CACHE_SIZE) {
+	vector<size_t> insertedAt(vertexCount, 0); //miss count when the vertex entered the cache, 0 = never
+	size_t misses = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		size_t& entered = insertedAt[indices[i]];
+		//still cached if fewer than cacheSize vertices were inserted after it
+		if (entered && misses - entered < cacheSize) continue;
+		entered = ++misses;
+	}
+	return misses;
+}
+
+
+//pass 1: Forsyth, "Linear-Speed Vertex Cache Optimisation"
+inline void optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) return;
+
+	//triangles of every vertex
+	vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t i = 0; i < indices.size(); i++) adjacencyOffset[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+	vector<unsigned int> adjacency(indices.size());
+	vector<unsigned int> remaining(vertexCount, 0); //not yet emitted triangles of the vertex (the front of its adjacency range)
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int v = indices[i];
+		adjacency[adjacencyOffset[v] + remaining[v]++] = (unsigned int)(i / 3);
+	}
+
+	//vertex score: recently used vertices and vertices with few triangles left score high
+	auto vertexScore = [](int cachePosition, unsigned int triangles) {
+		if (triangles == 0) return -1.0f;
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			//the triangle just emitted: its vertices get a fixed score, so the next triangle isn't always its neighbour
+			if (cachePosition < 3) score = 0.75f;
+			else score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		return score + 2.0f / std::sqrt((float)triangles);
+	};
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) score[v] = vertexScore(-1, remaining[v]);
+	vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++) triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> output;
+	output.reserve(indices.size());
+	vector<unsigned int> cache, nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t scan = 0; //first triangle that may not be emitted yet (for restarts)
+	long long best = -1;
+
+	for (size_t n = 0; n < triangleCount; n++) {
+		if (best < 0) {
+			//nothing left around the cache: continue with the next triangle in input order
+			while (emitted[scan]) scan++;
+			best = (long long)scan;
+		}
+		unsigned int triangle = (unsigned int)best;
+		emitted[triangle] = true;
+		const unsigned int* corners = &indices[3 * triangle];
+		output.insert(output.end(), corners, corners + 3);
+
+		//the triangle is done: take it out of its vertices' remaining triangles
+		for (unsigned int c = 0; c < 3; c++) {
+			unsigned int v = corners[c];
+			unsigned int* first = &adjacency[adjacencyOffset[v]];
+			unsigned int* last = first + remaining[v];
+			*std::find(first, last, triangle) = *(last - 1);
+			remaining[v]--;
+		}
+
+		//LRU update: the triangle's vertices move to the front
+		nextCache.assign(corners, corners + 3);
+		for (size_t i = 0; i < cache.size(); i++)
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2]) nextCache.push_back(cache[i]);
+		cache.swap(nextCache);
+
+		//rescore the cached vertices (and the ones that just fell out), then their triangles
+		for (size_t i = 0; i < cache.size(); i++) {
+			unsigned int v = cache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+			score[v] = vertexScore(cachePosition[v], remaining[v]);
+		}
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++) {
+			unsigned int v = cache[i];
+			for (unsigned int a = 0; a < remaining[v]; a++) {
+				unsigned int t = adjacency[adjacencyOffset[v] + a];
+				triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+		if (cache.size() > FORSYTH_CACHE_SIZE) cache.resize(FORSYTH_CACHE_SIZE);
+	}
+	indices.swap(output);
+}
+
+
+//pass 2: cut the cache-ordered triangles into clusters and draw the outward facing clusters first
+inline void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, float threshold = OVERDRAW_THRESHOLD) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2) return;
+
+	//hard boundaries: triangles that miss the cache with all three vertices start a new cluster
+	vector<size_t> clusterStart;
+	vector<size_t> insertedAt(vertices.size(), 0);
+	size_t misses = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		unsigned int triangleMisses = 0;
+		for (unsigned int c = 0; c < 3; c++) {
+			size_t& entered = insertedAt[indices[3 * t + c]];
+			if (entered && misses - entered < STATS_CACHE_SIZE) continue;
+			entered = ++misses;
+			triangleMisses++;
+		}
+		if (t == 0 || triangleMisses == 3) clusterStart.push_back(t);
+	}
+	if (clusterStart.size() < 2) return;
+	clusterStart.push_back(triangleCount);
+
+	//area weighted centroid + normal of every cluster, and of the whole mesh
+	size_t clusterCount = clusterStart.size() - 1;
+	vector<glm::vec3> clusterCentroid(clusterCount), clusterNormal(clusterCount);
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t k = 0; k < clusterCount; k++) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusterStart[k]; t < clusterStart[k + 1]; t++) {
+			const glm::vec3& a = vertices[indices[3 * t]].Position;
+			const glm::vec3& b = vertices[indices[3 * t + 1]].Position;
+			const glm::vec3& c = vertices[indices[3 * t + 2]].Position;
+			glm::vec3 faceNormal = glm::cross(b - a, c - a); //length = 2 * area
+			float faceArea = glm::length(faceNormal);
+			centroid = centroid + (a + b + c) * (faceArea / 3.0f);
+			normal = normal + faceNormal;
+			area += faceArea;
+		}
+		meshCentroid = meshCentroid + centroid;
+		meshArea += area;
+		clusterCentroid[k] = area > 0.0f ? centroid / area : vertices[indices[3 * clusterStart[k]]].Position;
+		clusterNormal[k] = normal;
+	}
+	if (meshArea > 0.0f) meshCentroid = meshCentroid / meshArea;
+
+	//outward facing (seen first from most directions) -> drawn first
+	vector<float> sortKey(clusterCount);
+	vector<unsigned int> order(clusterCount);
+	for (size_t k = 0; k < clusterCount; k++) {
+		float normalLength = glm::length(clusterNormal[k]);
+		sortKey[k] = normalLength > 0.0f ? glm::dot(clusterCentroid[k] - meshCentroid, clusterNormal[k] / normalLength) : 0.0f;
+		order[k] = (unsigned int)k;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+	vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t i = 0; i < clusterCount; i++) {
+		size_t k = order[i];
+		output.insert(output.end(), indices.begin() + 3 * clusterStart[k], indices.begin() + 3 * clusterStart[k + 1]);
+	}
+
+	//the cluster seams may cost cache misses: keep the cache order if they cost too many
+	size_t before = simulateVertexCache(indices, vertices.size());
+	size_t after = simulateVertexCache(output, vertices.size());
+	if (after <= before * threshold) indices.swap(output);
+}
+
+
+//pass 3: renumber the vertices in the order of their first use (unreferenced vertices go to the end)
+inline void optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	const unsigned int UNUSED = 0xFFFFFFFFu;
+	vector<unsigned int> remap(vertices.size(), UNUSED);
+	vector<Vertex> output;
+	output.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int& target = remap[indices[i]];
+		if (target == UNUSED) {
+			target = (unsigned int)output.size();
+			output.push_back(vertices[indices[i]]);
+		}
+		indices[i] = target;
+	}
+	for (size_t v = 0; v < vertices.size(); v++) if (remap[v] == UNUSED) output.push_back(vertices[v]);
+	vertices.swap(output);
+}
+
+
+//run all passes on a triangle list and measure the vertex cache after each one
+inline MeshOptimizer_Report optimizeMesh(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	MeshOptimizer_Report report;
+	report.triangles = indices.size() / 3;
+	vector<bool> referenced(vertices.size(), false);
+	for (size_t i = 0; i < indices.size(); i++) referenced[indices[i]] = true;
+	report.vertices = std::count(referenced.begin(), referenced.end(), true);
+
+	report.transformed[PASS_ORIGINAL] = simulateVertexCache(indices, vertices.size());
+	optimizeVertexCache(indices, vertices.size());
+	report.transformed[PASS_VERTEX_CACHE] = simulateVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	report.transformed[PASS_OVERDRAW] = simulateVertexCache(indices, vertices.size());
+	optimizeVertexFetch(vertices, indices);
+	report.transformed[PASS_VERTEX_FETCH] = simulateVertexCache(indices, vertices.size());
+	return report;
+}
+#endif // !MESH_OPTIMIZER_H
@@ -0,0 +1,234 @@
+/*Level-of-detail chain by quadric error edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+* Every vertex accumulates the planes of its triangles as a quadric, collapsing an edge u->v costs the summed quadric evaluated at v.
+* The cheapest collapses are applied pass by pass until the triangle target is reached.
+* Collapses only move u onto the existing vertex v, so a level is just a new index list into the same vertices:
+* all levels of a mesh share its vertex range in the arena and only add indices.
+* Vertices on a UV/normal seam (the same position in several vertices) and on an open border are never moved,
+* so seams and silhouettes of open meshes stay where they are.
+* generateLODs() appends the levels to the mesh's indices and describes them with MeshLOD entries (see Mesh.h).*/
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "Mesh.h"
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+using namespace std;
+
+const unsigned int MAX_LOD_LEVELS = 5;     //including the full resolution level 0
+const float LOD_REDUCTION = 0.5f;          //triangles of a level relative to the one before
+const size_t LOD_MIN_TRIANGLES = 32;       //no level below this
+
+//symmetric 4x4 matrix of the plane equations (a, b, c, d): sum of (ax + by + cz + d)^2
+struct Quadric {
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+	Quadric(double a, double b, double c, double d) : a2(a * a), ab(a * b), ac(a * c), ad(a * d), b2(b * b), bc(b * c), bd(b * d), c2(c * c), cd(c * d), d2(d * d) {}
+
+	void add(const Quadric& q) {
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+		bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+	}
+	//squared distance sum of p to the planes
+	double evaluate(const glm::vec3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+			+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+			+ c2 * z * z + 2 * cd * z + d2;
+	}
+};
+
+
+//simplify a triangle list to about targetIndexCount indices.
+//error: receives the largest collapse error (distance in model units, approximate)
+inline vector<unsigned int> simplifyIndices(const vector<Vertex>& vertices, const vector<unsigned int>& indices, size_t targetIndexCount, float* error = nullptr) {
+	vector<unsigned int> result(indices);
+	if (error) *error = 0.0f;
+	size_t vertexCount = vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0) return result;
+
+	//weld by position: rep[v] = first vertex with v's position, seam vertices share a rep
+	vector<unsigned int> rep(vertexCount);
+	vector<unsigned int> wedges(vertexCount, 0);
+	{
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+		unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> first;
+		first.reserve(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++) {
+			rep[v] = first.emplace(vertices[v].Position, v).first->second;
+			wedges[rep[v]]++;
+		}
+	}
+
+	//border/non-manifold edges: used by other than exactly two triangles
+	vector<bool> locked(vertexCount, false);
+	{
+		unordered_map<uint64_t, unsigned int> edgeUse;
+		edgeUse.reserve(result.size());
+		for (size_t t = 0; t + 2 < result.size(); t += 3) {
+			for (unsigned int e = 0; e < 3; e++) {
+				uint64_t a = rep[result[t + e]], b = rep[result[t + (e + 1) % 3]];
+				edgeUse[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+			}
+		}
+		for (auto edge = edgeUse.begin(); edge != edgeUse.end(); edge++) {
+			if (edge->second == 2) continue;
+			locked[edge->first >> 32] = true;
+			locked[edge->first & 0xFFFFFFFFu] = true;
+		}
+		for (unsigned int v = 0; v < vertexCount; v++) if (wedges[rep[v]] > 1) locked[v] = true;
+	}
+
+	//plane quadric of every triangle, summed per rep
+	vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < result.size(); t += 3) {
+		const glm::vec3& p0 = vertices[result[t]].Position;
+		glm::vec3 normal = glm::cross(vertices[result[t + 1]].Position - p0, vertices[result[t + 2]].Position - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f) continue;
+		normal = normal / length;
+		Quadric plane(normal.x, normal.y, normal.z, -glm::dot(normal, p0));
+		for (unsigned int c = 0; c < 3; c++) quadrics[rep[result[t + c]]].add(plane);
+	}
+
+	struct Collapse {
+		unsigned int from, to;
+		double cost;
+	};
+	vector<Collapse> collapses;
+	vector<unsigned int> adjacencyOffset, adjacency;
+	vector<unsigned int> remap(vertexCount);
+	vector<bool> touched(vertexCount);
+	double maxCost = 0.0;
+
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		//triangles around every rep
+		adjacencyOffset.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < result.size(); i++) adjacencyOffset[rep[result[i]] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+		adjacency.resize(result.size());
+		vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) adjacency[fill[rep[result[i]]]++] = (unsigned int)(i / 3);
+
+		//every edge in both directions, cheapest first
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (unsigned int e = 0; e < 3; e++) {
+				unsigned int a = rep[result[3 * t + e]], b = rep[result[3 * t + (e + 1) % 3]];
+				for (unsigned int direction = 0; direction < 2; direction++) {
+					unsigned int from = direction ? b : a, to = direction ? a : b;
+					if (locked[from] || wedges[to] > 1) continue; //(a seam vertex has no single set of attributes to collapse onto)
+					Quadric q = quadrics[from];
+					q.add(quadrics[to]);
+					Collapse collapse = { from, to, q.evaluate(vertices[to].Position) };
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		//apply independent collapses (no shared triangles within a pass) until the target is met
+		for (unsigned int v = 0; v < vertexCount; v++) remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+		size_t removed = 0, needed = triangleCount - targetIndexCount / 3;
+		for (size_t c = 0; c < collapses.size() && removed < needed; c++) {
+			const Collapse& collapse = collapses[c];
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			//reject collapses that flip a triangle around from, or whose triangles an earlier collapse of this pass changed
+			const glm::vec3& target = vertices[collapse.to].Position;
+			bool flips = false;
+			unsigned int collapsing = 0;
+			for (unsigned int a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1] && !flips; a++) {
+				const unsigned int* corners = &result[3 * adjacency[a]];
+				glm::vec3 before[3], after[3];
+				bool hasTarget = false;
+				for (unsigned int k = 0; k < 3; k++) {
+					if (touched[rep[corners[k]]]) flips = true;
+					before[k] = after[k] = vertices[corners[k]].Position;
+					if (rep[corners[k]] == collapse.from) after[k] = target;
+					if (rep[corners[k]] == collapse.to) hasTarget = true;
+				}
+				if (flips) break;
+				if (hasTarget) { collapsing++; continue; } //this triangle degenerates and goes away
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f) flips = true;
+			}
+			if (flips || collapsing == 0) continue;
+
+			//claim the neighbourhood so the flip test of this pass stays valid
+			for (unsigned int a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; a++)
+				for (unsigned int k = 0; k < 3; k++) touched[rep[result[3 * adjacency[a] + k]]] = true;
+			touched[collapse.to] = true;
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+			removed += collapsing;
+		}
+		if (removed == 0) break; //everything left is locked or would flip
+
+		//rewrite the triangles, drop the degenerate ones
+		//(only single-vertex positions move or are moved onto, seam vertices keep their attributes)
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			unsigned int corners[3];
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int v = result[3 * t + k];
+				corners[k] = remap[rep[v]] != rep[v] ? remap[rep[v]] : v;
+			}
+			if (rep[corners[0]] == rep[corners[1]] || rep[corners[1]] == rep[corners[2]] || rep[corners[0]] == rep[corners[2]]) continue;
+			result[write++] = corners[0];
+			result[write++] = corners[1];
+			result[write++] = corners[2];
+		}
+		result.resize(write);
+	}
+
+	if (error) *error = (float)std::sqrt(maxCost);
+	return result;
+}
+
+
+//build the LOD chain of a mesh: level n+1 has about LOD_REDUCTION of the triangles of level n.
+//the coarser levels are appended to indices, lods receives one entry per level (lods[0] = the given triangles).
+//(stops early when a level can't be reduced any more)
+inline void generateLODs(const vector<Vertex>& vertices, vector<unsigned int>& indices, vector<MeshLOD>& lods) {
+	lods.clear();
+	MeshLOD full = { 0, (unsigned int)indices.size(), 0.0f };
+	lods.push_back(full);
+
+	vector<unsigned int> level(indices);
+	float error = 0.0f;
+	while (lods.size() < MAX_LOD_LEVELS) {
+		size_t target = (size_t)(level.size() / 3 * LOD_REDUCTION) * 3;
+		if (target / 3 < LOD_MIN_TRIANGLES) break;
+		float levelError = 0.0f;
+		vector<unsigned int> coarser = simplifyIndices(vertices, level, target, &levelError);
+		if (coarser.size() > level.size() * 9 / 10) break;
+
+		//the error of a level is measured against the level before it: add them up
+		error += levelError;
+		MeshLOD lod = { (unsigned int)indices.size(), (unsigned int)coarser.size(), error };
+		lods.push_back(lod);
+		indices.insert(indices.end(), coarser.begin(), coarser.end());
+		level.swap(coarser);
+	}
+}
+#endif // !MESH_SIMPLIFIER_H
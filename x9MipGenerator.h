@@ -0,0 +1,268 @@
+/*Mip chain generation on the CPU.
+* glGenerateMipmap runs on the GL thread right after the upload, and how it filters is up to the driver (usually a plain 2x2 box,
+* on the sRGB encoded values). generateMips() computes every level on the calling thread instead (decodeImage: a decode worker),
+* so the upload only has to send the levels (uploadTexture: one glTexImage2D per level).
+*   MIP_BOX: each target texel is the area average of the source texels it covers (exact for odd sizes too)
+*   MIP_KAISER: Kaiser windowed sinc (2 target texels each side, alpha 4): sharper mips, less aliasing than the box
+* flags: MIP_SRGB averages sRGB colors in linear space (gammaCorrection textures: a plain average darkens the mips),
+* MIP_NORMAL_MAP decodes the texels into vectors and renormalizes them after filtering.
+* The filter is separable: per target row, a vertical pass over whole source rows (AVX2: 8 floats per instruction, SSE: 4)
+* then a horizontal pass (SSE: one RGBA texel per instruction). Every level is filtered from the float result of the previous one,
+* so the 8 bit rounding doesn't add up along the chain. threadCount > 1 splits the rows of the big levels between threads.*/
+
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIP_SSE
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_AVX2
+#endif
+
+enum Mip_Filter { MIP_BOX, MIP_KAISER };
+
+//what the texels are (generateMips() flags, decodeImage() mipFlags)
+const unsigned int MIP_SRGB = 1;       //sRGB encoded color channels (alpha stays linear)
+const unsigned int MIP_NORMAL_MAP = 2; //xyz = normal * 0.5 + 0.5
+
+//levels of a full chain down to 1x1 (level 0 included)
+inline int mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		levels++;
+	}
+	return levels;
+}
+
+//the source texels and weights of every target texel along one axis
+struct MipWeights {
+	int taps;                 //source texels per target texel
+	std::vector<int> index;   //[target * taps + tap]: source texel (clamped to the edge)
+	std::vector<float> weight;
+};
+
+//modified Bessel function of the first kind, order 0 (the Kaiser window)
+inline double mipBesselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+inline MipWeights mipWeights(Mip_Filter filter, int source, int target) {
+	MipWeights weights;
+	double scale = (double)source / target;
+	if (filter == MIP_BOX) weights.taps = source % target == 0 ? source / target : (int)std::ceil(scale) + 1;
+	else weights.taps = (int)std::ceil(4.0 * scale); //(texel centers strictly inside +-2 target texels)
+	weights.index.resize((size_t)target * weights.taps);
+	weights.weight.resize((size_t)target * weights.taps);
+	const double alpha = 4.0, pi = 3.14159265358979323846;
+	for (int t = 0; t < target; t++) {
+		int first;
+		if (filter == MIP_BOX) first = (int)std::floor(t * scale);
+		else first = (int)std::floor((t + 0.5) * scale - 2.0 * scale - 0.5) + 1;
+		double sum = 0.0;
+		for (int k = 0; k < weights.taps; k++) {
+			int s = first + k;
+			double w;
+			if (filter == MIP_BOX) {
+				//how much of [s, s + 1) lies in the target texel's footprint
+				double lo = t * scale, hi = (t + 1) * scale;
+				w = std::max(0.0, std::min(hi, s + 1.0) - std::max(lo, (double)s));
+			}
+			else {
+				double d = (s + 0.5 - (t + 0.5) * scale) / scale; //in target texels
+				if (std::fabs(d) >= 2.0) w = 0.0;
+				else {
+					double sinc = d == 0.0 ? 1.0 : std::sin(pi * d) / (pi * d);
+					w = sinc * mipBesselI0(alpha * std::sqrt(1.0 - d * d / 4.0)) / mipBesselI0(alpha);
+				}
+			}
+			weights.index[(size_t)t * weights.taps + k] = std::min(std::max(s, 0), source - 1);
+			weights.weight[(size_t)t * weights.taps + k] = (float)w;
+			sum += w;
+		}
+		for (int k = 0; k < weights.taps; k++) weights.weight[(size_t)t * weights.taps + k] = (float)(weights.weight[(size_t)t * weights.taps + k] / sum);
+	}
+	return weights;
+}
+
+//sRGB <-> linear conversion tables
+struct MipTables {
+	static const int FROM_LINEAR_SIZE = 16384;
+	float toLinear[256];
+	unsigned char fromLinear[FROM_LINEAR_SIZE + 1]; //linear value * FROM_LINEAR_SIZE -> sRGB byte
+	MipTables() {
+		for (int i = 0; i < 256; i++) {
+			double c = i / 255.0;
+			toLinear[i] = (float)(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+		}
+		for (int i = 0; i <= FROM_LINEAR_SIZE; i++) {
+			double v = (double)i / FROM_LINEAR_SIZE;
+			double c = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+			fromLinear[i] = (unsigned char)std::lround(c * 255.0);
+		}
+	}
+};
+inline const MipTables& mipTables() {
+	static const MipTables tables;
+	return tables;
+}
+
+//8 bit texels -> 4 floats per texel (missing channels are 0)
+inline void mipDecodeRow(const unsigned char* row, int width, int components, unsigned int flags, float* out) {
+	const MipTables& tables = mipTables();
+	bool normal = (flags & MIP_NORMAL_MAP) && components >= 3;
+	bool srgb = !normal && (flags & MIP_SRGB) && components >= 3;
+	for (int x = 0; x < width; x++, row += components, out += 4) {
+		for (int c = 0; c < 4; c++) {
+			if (c >= components) out[c] = 0.0f;
+			else if (normal && c < 3) out[c] = row[c] * (2.0f / 255.0f) - 1.0f;
+			else if (srgb && c < 3) out[c] = tables.toLinear[row[c]];
+			else out[c] = row[c] * (1.0f / 255.0f);
+		}
+	}
+}
+
+//4 floats per texel -> 8 bit texels
+inline void mipEncodeRow(const float* row, int width, int components, unsigned int flags, unsigned char* out) {
+	const MipTables& tables = mipTables();
+	bool normal = (flags & MIP_NORMAL_MAP) && components >= 3;
+	bool srgb = !normal && (flags & MIP_SRGB) && components >= 3;
+	for (int x = 0; x < width; x++, row += 4, out += components) {
+		for (int c = 0; c < components; c++) {
+			float value = normal && c < 3 ? row[c] * 0.5f + 0.5f : row[c];
+			value = std::min(std::max(value, 0.0f), 1.0f);
+			if (srgb && c < 3) out[c] = tables.fromLinear[(int)(value * MipTables::FROM_LINEAR_SIZE + 0.5f)];
+			else out[c] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+}
+
+//one target row: vertical pass (rows[tap] weighted by columnWeights[tap]) into vertical, then the horizontal pass into out
+inline void mipFilterRow(const float* const* rows, const float* columnWeights, int taps, int sourceWidth,
+	const MipWeights& rowWeights, int targetWidth, float* vertical, float* out, bool simd) {
+	int floats = sourceWidth * 4;
+	int i = 0;
+	if (simd) {
+#ifdef MIP_AVX2
+		for (; i + 8 <= floats; i += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for (int k = 0; k < taps; k++) sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(columnWeights[k]), _mm256_loadu_ps(rows[k] + i)));
+			_mm256_storeu_ps(vertical + i, sum);
+		}
+#endif
+#ifdef MIP_SSE
+		for (; i + 4 <= floats; i += 4) {
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < taps; k++) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(columnWeights[k]), _mm_loadu_ps(rows[k] + i)));
+			_mm_storeu_ps(vertical + i, sum);
+		}
+#endif
+	}
+	for (; i < floats; i++) {
+		float sum = 0.0f;
+		for (int k = 0; k < taps; k++) sum += columnWeights[k] * rows[k][i];
+		vertical[i] = sum;
+	}
+
+	const int* index = rowWeights.index.data();
+	const float* weight = rowWeights.weight.data();
+	for (int x = 0; x < targetWidth; x++, index += rowWeights.taps, weight += rowWeights.taps, out += 4) {
+#ifdef MIP_SSE
+		if (simd) {
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < rowWeights.taps; k++) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(vertical + index[k] * 4)));
+			_mm_storeu_ps(out, sum);
+			continue;
+		}
+#endif
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		for (int k = 0; k < rowWeights.taps; k++) {
+			const float* texel = vertical + index[k] * 4;
+			for (int c = 0; c < 4; c++) out[c] += weight[k] * texel[c];
+		}
+	}
+}
+
+//levels 1 .. n of an 8 bit image with 1-4 components (level 0 is pixels itself), tightly packed rows
+inline void generateMips(const unsigned char* pixels, int width, int height, int components, Mip_Filter filter, unsigned int flags,
+	std::vector<std::vector<unsigned char>>& levels, unsigned int threadCount = 1, bool simd = true) {
+	levels.clear();
+	int levelCount = mipLevelCount(width, height);
+	std::vector<float> source, target; //float texels of the previous/current level
+	int sourceWidth = width, sourceHeight = height;
+	for (int level = 1; level < levelCount; level++) {
+		int targetWidth = sourceWidth > 1 ? sourceWidth / 2 : 1, targetHeight = sourceHeight > 1 ? sourceHeight / 2 : 1;
+		MipWeights columnWeights = mipWeights(filter, sourceHeight, targetHeight), rowWeights = mipWeights(filter, sourceWidth, targetWidth);
+		levels.push_back(std::vector<unsigned char>((size_t)targetWidth * targetHeight * components));
+		unsigned char* bytes = levels.back().data();
+		bool keepFloats = level + 1 < levelCount; //(the last level isn't the source of another one)
+		target.resize(keepFloats ? (size_t)targetWidth * targetHeight * 4 : 0);
+
+		auto filterRows = [&](int firstRow, int endRow) {
+			int taps = columnWeights.taps;
+			std::vector<float> vertical((size_t)sourceWidth * 4), row((size_t)targetWidth * 4);
+			std::vector<const float*> rows(taps);
+			//level 1 reads the 8 bit image: the rows of the window are decoded into a small cache (row y in slot y % taps)
+			std::vector<float> cache;
+			std::vector<int> cachedRow;
+			if (level == 1) {
+				cache.resize((size_t)taps * sourceWidth * 4);
+				cachedRow.assign(taps, -1);
+			}
+			for (int y = firstRow; y < endRow; y++) {
+				for (int k = 0; k < taps; k++) {
+					int sourceRow = columnWeights.index[(size_t)y * taps + k];
+					if (level == 1) {
+						int slot = sourceRow % taps;
+						float* cached = &cache[(size_t)slot * sourceWidth * 4];
+						if (cachedRow[slot] != sourceRow) {
+							mipDecodeRow(pixels + (size_t)sourceRow * sourceWidth * components, sourceWidth, components, flags, cached);
+							cachedRow[slot] = sourceRow;
+						}
+						rows[k] = cached;
+					}
+					else rows[k] = &source[(size_t)sourceRow * sourceWidth * 4];
+				}
+				mipFilterRow(rows.data(), &columnWeights.weight[(size_t)y * taps], taps, sourceWidth, rowWeights, targetWidth, vertical.data(), row.data(), simd);
+				if ((flags & MIP_NORMAL_MAP) && components >= 3) {
+					for (int x = 0; x < targetWidth; x++) {
+						float* n = &row[(size_t)x * 4];
+						float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+						if (length > 1e-8f) for (int c = 0; c < 3; c++) n[c] /= length;
+					}
+				}
+				if (keepFloats) std::copy(row.begin(), row.end(), target.begin() + (size_t)y * targetWidth * 4);
+				mipEncodeRow(row.data(), targetWidth, components, flags, bytes + (size_t)y * targetWidth * components);
+			}
+		};
+
+		//small levels aren't worth a thread
+		unsigned int threads = (size_t)targetWidth * targetHeight >= 16384 ? std::min(threadCount, (unsigned int)targetHeight) : 1;
+		if (threads <= 1) filterRows(0, targetHeight);
+		else {
+			std::vector<std::thread> workers;
+			for (unsigned int t = 0; t < threads; t++)
+				workers.emplace_back(filterRows, (int)((size_t)targetHeight * t / threads), (int)((size_t)targetHeight * (t + 1) / threads));
+			for (unsigned int t = 0; t < threads; t++) workers[t].join();
+		}
+		source.swap(target);
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+}
+#endif // !MIP_GENERATOR_H
@@ -4,6 +4,15 @@
 #include "stb_image.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "TextureLoader.h"
+#include "TextureCache.h"
+#include "ModelBake.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "ModelLoader.h"
 
 //import a model and translate it to my own structure
 #include <assimp/Importer.hpp>
@@ -15,40 +24,59 @@
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false) {
+//how Model::Draw submits its meshes
+enum Model_DrawMode {
+	DRAW_PER_MESH, //one glDrawElementsBaseVertex + texture setup per mesh
+	DRAW_BATCHED   //meshes grouped by material, one multi-draw per material
+};
+
+//layout of one command in GL_DRAW_INDIRECT_BUFFER (fixed by the GL spec)
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+//meshes that use the same textures, drawn with one call
+struct MaterialBatch {
+	unsigned int meshIndex;     //a mesh of the batch, its textures are bound for the whole batch
+	unsigned int node;          //scene graph node of all its meshes (SceneGraph::NO_PARENT: meshes at the model origin)
+	unsigned int firstCommand;  //range in Model::drawCommands
+	unsigned int commandCount;
+	//the same ranges as separate arrays for glMultiDrawElementsBaseVertex (when indirect draws aren't available)
+	vector<GLsizei> counts;
+	vector<const void*> offsets;
+	vector<GLint> baseVertices;
+};
+
+//how a Model loads. set the fields by name:
+//  ModelOptions options;
+//  options.format = VERTEX_PACKED;
+//  Model model("backpack/backpack.obj", options);
+struct ModelOptions {
+	bool gamma = false;            //sRGB textures
+	bool parallelTextures = true;  //decode the material textures on worker threads before building the meshes
+	Vertex_Format format = VERTEX_FULL; //layout of the vertex buffer (VERTEX_PACKED: less than half the VRAM and fetch bandwidth)
+	bool optimize = false;         //reorder triangles + vertices (MeshOptimizer.h)
+	bool lods = false;             //build a level of detail chain per mesh (MeshSimplifier.h)
+	bool streamTextures = false;   //textures start as their small mips and refine over the next frames (needs TextureStreamer::update() per frame)
+};
+
+unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false, bool normalMap = false) {
 	string filename = string(path);
 	filename = directory + '/' + filename;
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-	
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format;
-		if (nrComponents == 1) format = GL_RED;
-		else if (nrComponents == 3) format = GL_RGB;
-		else if (nrComponents == 4) format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else {
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-	return textureID;
+	//decode and upload on the calling thread (serial path), unless another Model already loaded it
+	return TextureCache::instance().load(filename, gamma, normalMap);
 }
 
 
@@ -59,20 +87,137 @@ public:
 	//model data
 	vector<Texture> textures_loaded; 
 	//└stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	unordered_map<string, unsigned int> textureIndex; //textureKey() -> index in textures_loaded (no linear scan)
 	vector<Mesh> meshes;
+	//the node hierarchy of the source file (one node per aiNode, Mesh::node points into it).
+	//Draw() sets the "model" uniform to the caller's model matrix * the world matrix of the mesh's node
+	SceneGraph nodes;
 	string directory;
 	bool gammaCorrection;
+	bool parallelTextures; //decode the material textures on worker threads before building the meshes
+	bool streamTextures;   //don't wait for the textures at all: they stream in while the model is drawn (TextureStreamer.h)
+	//geometry arena: the vertices/indices of all meshes live in one VBO + one EBO, described by one VAO.
+	//each Mesh is a baseVertex/firstIndex range of it, so a whole Draw() needs a single VAO binding.
+	unsigned int VAO, VBO, EBO;
+	Vertex_Format vertexFormat; //layout of the arena's vertices (VERTEX_PACKED: less than half the VRAM and fetch bandwidth)
+	size_t vertexBytes;         //size of the arena's vertex buffer
+	//post-load optimization of the ASSIMP meshes (triangle + vertex order, see MeshOptimizer.h)
+	bool optimizeMeshes;
+	MeshOptimizer_Report optimizeReport; //ACMR/ATVR of all meshes after each pass
+	//levels of detail: built per mesh at load (or read from a baked file), picked per mesh by Draw(shader, camera, model)
+	bool buildLODs;
+	float lodPixelError;      //largest allowed geometric error of a level on screen, in pixels
+	float lodViewportHeight;  //pixels the camera's field of view spans vertically
+	//submission
+	Model_DrawMode drawMode;
+	unsigned int drawCalls; //draw calls issued by the last Draw()
+	size_t trianglesSubmitted; //triangles drawn by the last Draw()
+	unsigned int meshesVisible, meshesCulled; //frustum culling result of the last Draw() (all visible without a projection)
+	vector<DrawElementsIndirectCommand> drawCommands;
+	vector<MaterialBatch> batches;
+	unsigned int indirectBuffer; //drawCommands on the GPU (0 if glMultiDrawElementsIndirect isn't available)
 
 	//constructor
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma) {
+	Model(string const &path, const ModelOptions& options = ModelOptions())
+		: gammaCorrection(options.gamma), parallelTextures(options.parallelTextures || options.streamTextures), streamTextures(options.streamTextures),
+		VAO(0), VBO(0), EBO(0), vertexFormat(options.format), vertexBytes(0), optimizeMeshes(options.optimize), buildLODs(options.lods),
+		lodPixelError(1.0f), lodViewportHeight(1200.0f), drawMode(DRAW_PER_MESH), drawCalls(0), trianglesSubmitted(0), meshesVisible(0), meshesCulled(0),
+		indirectBuffer(0), modelLocation(-1), modelGeneration(0), placedNode(SceneGraph::NO_PARENT), callerModelKnown(false), loader(nullptr), imported(false), loaded(false) {
 		//path: a file location
-		loadModel(path);
+		//(a .xmdl file written by the BakeModel tool is memory mapped instead of going through ASSIMP)
+		if (isBakedPath(path)) loadBaked(path);
+		else loadModel(path);
+		loaded = true;
 	}
 
-	//draw the model
+	//asynchronous: returns at once. the file is imported and converted on a worker of modelLoader,
+	//its buffers are created by modelLoader.poll() on the GL thread, Draw() draws nothing until then (see ready()).
+	//the textures are always streamed (TextureStreamer.h, options.parallelTextures/streamTextures are ignored),
+	//so the upload doesn't wait for any image decode either
+	Model(ModelLoader& modelLoader, string const &path, const ModelOptions& options = ModelOptions())
+		: gammaCorrection(options.gamma), parallelTextures(true), streamTextures(true), VAO(0), VBO(0), EBO(0), vertexFormat(options.format),
+		vertexBytes(0), optimizeMeshes(options.optimize), buildLODs(options.lods), lodPixelError(1.0f), lodViewportHeight(1200.0f),
+		drawMode(DRAW_PER_MESH), drawCalls(0), trianglesSubmitted(0), meshesVisible(0), meshesCulled(0), indirectBuffer(0), modelLocation(-1),
+		modelGeneration(0), placedNode(SceneGraph::NO_PARENT), callerModelKnown(false), loader(&modelLoader), imported(false), loaded(false) {
+		bool baked = isBakedPath(path);
+		//(worker: no GL calls, nothing else touches this Model's data until the upload)
+		modelLoader.submit(this, [this, path, baked] { imported = baked ? readBaked(path) : importModel(path); },
+			[this, baked] {
+				if (imported) {
+					resolveTextures();
+					if (baked) uploadBaked();
+					else setupArena();
+				}
+				loaded = true;
+				loader = nullptr;
+			});
+	}
+
+	//the textures are shared through the TextureCache, so give our references back
+	~Model() {
+		//(a load still in flight must not write into this Model any more)
+		if (loader) loader->cancel(this);
+		for (unsigned int i = 0; i < textures_loaded.size(); i++) TextureCache::instance().release(textures_loaded[i].id);
+		GLState::instance().vertexArrayDeleted(VAO);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteBuffers(1, &indirectBuffer);
+	}
+	Model(const Model&) = delete;
+	Model& operator=(const Model&) = delete;
+
+	//true once the meshes are on the GPU (always for the blocking constructors, after ModelLoader::poll() for the asynchronous one).
+	//(a file that failed to load is ready with no meshes)
+	bool ready() const { return loaded; }
+
+	//draw the model (every mesh at full resolution)
 	void Draw(Shader& shader) {
-		//loops over each of the meshes to call their respective Draw()
-		for (unsigned int i = 0; i < meshes.size(); i++) meshes[i].Draw(shader);
+		if (!loaded) return;
+		updateNodes();
+		selectLODs(nullptr, glm::mat4(1.0f));
+		submit(shader, nullptr);
+	}
+
+	//draw the model with a level of detail per mesh that fits its size on screen.
+	//model: the model matrix the shader uses, camera: its Position and Zoom (vertical FOV) give the projected size
+	void Draw(Shader& shader, const Camera& camera, const glm::mat4& model) {
+		if (!loaded) return;
+		updateNodes();
+		selectLODs(&camera, model);
+		submit(shader, &model);
+	}
+
+	//the same, without the meshes that are outside the view frustum of camera + projection
+	void Draw(Shader& shader, const Camera& camera, const glm::mat4& model, const glm::mat4& projection) {
+		if (!loaded) return;
+		updateNodes();
+		selectLODs(&camera, model);
+		cullMeshes(extractFrustum(projection * camera.GetViewMatrix() * model));
+		submit(shader, &model);
+	}
+
+	//number of draw calls a Draw() issues in the given mode (0 until ready())
+	unsigned int countDrawCalls(Model_DrawMode mode) {
+		if (!loaded) return 0;
+		if (mode == DRAW_PER_MESH) return (unsigned int)meshes.size();
+		updateNodes();
+		if (batches.empty()) buildBatches();
+		return (unsigned int)batches.size();
+	}
+
+	//move a node (and everything below it) relative to its parent, takes effect with the next Draw() (only once ready())
+	void setNodeTransform(unsigned int node, const glm::mat4& local) {
+		nodes.setLocal(node, local);
+		//meshes that were batched at the model origin can't follow: regroup them
+		for (unsigned int i = 0; i < batches.size(); i++) {
+			if (batches[i].node != SceneGraph::NO_PARENT) continue;
+			for (unsigned int c = batches[i].firstCommand; c < batches[i].firstCommand + batches[i].commandCount; c++) {
+				if (!nodes.inSubtree(meshes[commandMeshes[c]].node, node)) continue;
+				batches.clear();
+				break;
+			}
+		}
 	}
 	
 
@@ -81,9 +226,258 @@ public:
 
 
 private:
+	vector<unsigned int> selectedLODs; //level per mesh for the next submit()
+	vector<unsigned int> commandLODs;  //levels the draw commands currently point at
+	vector<unsigned int> commandMeshes; //mesh of every draw command
+	static const unsigned int LOD_CULLED = 0xFFFFFFFFu; //selectedLODs entry of a mesh outside the frustum
+	CullBounds meshBounds;              //boxes of the meshes, model space (placed by their node)
+	vector<float> meshScales;           //largest scale of each mesh's node (LOD errors are in mesh units)
+	vector<unsigned char> meshVisible;
+	GLint modelLocation;                //"model" uniform of the program with modelGeneration (resolved once per shader, not per draw)
+	unsigned int modelGeneration;       //Shader::generation (not the GL name: a reloaded program may get the old one back)
+	//during submit(): the node whose placement "model" holds (NO_PARENT: the caller's matrix itself), and that matrix
+	unsigned int placedNode;
+	glm::mat4 callerModel;
+	bool callerModelKnown;              //false: Draw(shader) without a matrix, read back from the program the first time a node needs it
+	//asynchronous loading
+	ModelLoader* loader;                //the loader of a load still in flight (nullptr once uploaded)
+	bool imported;                      //the worker part succeeded (written by the worker, read by the upload)
+	bool loaded;                        //ready()
+	unique_ptr<BakedModel> bakedFile;   //the mapped .xmdl between readBaked() and uploadBaked()
+	vector<PackedVertex> bakedPacked;   //its vertices converted to VERTEX_PACKED by readBaked()
+
+	static bool isBakedPath(const string& path) { return path.size() > 5 && path.compare(path.size() - 5, 5, ".xmdl") == 0; }
+
+	//recompute the changed world matrices, and the model space bounds if any moved
+	void updateNodes() {
+		if (!nodes.update() && meshBounds.size() == meshes.size()) return;
+		meshBounds.resize(meshes.size());
+		meshScales.resize(meshes.size());
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			const Mesh& mesh = meshes[i];
+			const glm::mat4& world = nodes.worlds[mesh.node];
+			glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f, extent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+			//box around the transformed box: every axis of the node adds |axis| * extent
+			glm::vec3 placedExtent;
+			for (int row = 0; row < 3; row++)
+				placedExtent[row] = std::fabs(world[0][row]) * extent.x + std::fabs(world[1][row]) * extent.y + std::fabs(world[2][row]) * extent.z;
+			meshBounds.setBox(i, glm::vec3(world * glm::vec4(center, 1.0f)), placedExtent);
+			meshScales[i] = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+		}
+	}
+
+	//mark the meshes outside the frustum (planes in model space) as LOD_CULLED
+	void cullMeshes(const Frustum& frustum) {
+		meshVisible.resize(meshes.size());
+		if (meshes.empty()) return;
+		meshesVisible = (unsigned int)cullBoxes(frustum, meshBounds, &meshVisible[0]);
+		meshesCulled = (unsigned int)meshes.size() - meshesVisible;
+		for (unsigned int i = 0; i < meshes.size(); i++) if (!meshVisible[i]) selectedLODs[i] = LOD_CULLED;
+	}
+
+	//pick the coarsest level of every mesh whose error stays below lodPixelError pixels on screen
+	//(camera = nullptr: level 0 everywhere)
+	void selectLODs(const Camera* camera, const glm::mat4& model) {
+		if (selectedLODs.size() != meshes.size()) selectedLODs.assign(meshes.size(), 0);
+		meshesVisible = (unsigned int)meshes.size();
+		meshesCulled = 0;
+		if (!camera) {
+			std::fill(selectedLODs.begin(), selectedLODs.end(), 0);
+			return;
+		}
+		//world units -> pixels at distance 1 (perspective: divide by the distance)
+		float pixelsAtUnitDistance = lodViewportHeight / (2.0f * std::tan(glm::radians(camera->Zoom) * 0.5f));
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			const Mesh& mesh = meshes[i];
+			unsigned int lod = 0;
+			glm::vec3 center = glm::vec3(model * glm::vec4(meshBounds.centerX[i], meshBounds.centerY[i], meshBounds.centerZ[i], 1.0f));
+			float distance = glm::length(center - camera->Position) - meshBounds.radius[i] * scale;
+			if (distance > 0.0f) {
+				float pixelsPerUnit = pixelsAtUnitDistance / distance * scale * meshScales[i];
+				while (lod + 1 < mesh.lods.size() && mesh.lods[lod + 1].error * pixelsPerUnit <= lodPixelError) lod++;
+			}
+			selectedLODs[i] = lod;
+		}
+	}
+
+	//issue the draws with the selected levels.
+	//each mesh is placed by folding its node into the "model" uniform (model * world), so any shader with a model matrix works.
+	//model: the caller's model matrix (nullptr: the one it set on the program). "model" holds it again afterwards
+	void submit(Shader& shader, const glm::mat4* model) {
+		drawCalls = 0;
+		trianglesSubmitted = 0;
+		if (shader.generation != modelGeneration) {
+			modelLocation = shader.uniforms.find("model");
+			modelGeneration = shader.generation;
+		}
+		placedNode = SceneGraph::NO_PARENT;
+		callerModelKnown = model != nullptr;
+		if (model) callerModel = *model;
+		//all meshes share the arena's buffers -> bind it once
+		GLState::instance().bindVertexArray(VAO);
+		if (drawMode == DRAW_BATCHED) drawBatched(shader);
+		else {
+			//loops over each of the meshes to bind their textures and draw their range
+			for (unsigned int i = 0; i < meshes.size(); i++) {
+				if (selectedLODs[i] == LOD_CULLED) continue;
+				placeNode(shader, meshes[i].node);
+				meshes[i].bindTextures(shader);
+				meshes[i].drawElements(selectedLODs[i]);
+				trianglesSubmitted += meshes[i].lodIndexCount(selectedLODs[i]) / 3;
+				drawCalls++;
+			}
+		}
+		placeNode(shader, SceneGraph::NO_PARENT);
+	}
+
+	//set "model" to the caller's matrix * the world matrix of node (NO_PARENT or a node at the origin: the caller's matrix),
+	//skipped if it already holds that
+	void placeNode(const Shader& shader, unsigned int node) {
+		if (node != SceneGraph::NO_PARENT && isIdentity(nodes.worlds[node])) node = SceneGraph::NO_PARENT;
+		if (node == placedNode) return;
+		if (!callerModelKnown) {
+			//(one query per Draw(shader), and only for a model whose nodes move its meshes)
+			callerModel = glm::mat4(1.0f);
+			if (modelLocation >= 0) glGetUniformfv(shader.ID, modelLocation, &callerModel[0][0]);
+			callerModelKnown = true;
+		}
+		placedNode = node;
+		if (node == SceneGraph::NO_PARENT) glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &callerModel[0][0]);
+		else {
+			glm::mat4 placed = callerModel * nodes.worlds[node];
+			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &placed[0][0]);
+		}
+	}
+
+	//point the draw commands at the selected levels (only the commands whose level changed, uploaded in one call)
+	void updateCommandLODs() {
+		bool changed = false;
+		for (unsigned int c = 0; c < commandMeshes.size(); c++) {
+			unsigned int lod = selectedLODs[commandMeshes[c]];
+			if (lod == commandLODs[c]) continue;
+			const Mesh& mesh = meshes[commandMeshes[c]];
+			//(a culled mesh keeps its slot in the multi-draw with an empty range)
+			drawCommands[c].count = lod == LOD_CULLED ? 0 : mesh.lodIndexCount(lod);
+			drawCommands[c].firstIndex = lod == LOD_CULLED ? 0 : mesh.lodFirstIndex(lod);
+			commandLODs[c] = lod;
+			changed = true;
+		}
+		if (!changed) return;
+		for (unsigned int i = 0; i < batches.size(); i++) {
+			MaterialBatch& batch = batches[i];
+			for (unsigned int c = 0; c < batch.commandCount; c++) {
+				const DrawElementsIndirectCommand& command = drawCommands[batch.firstCommand + c];
+				batch.counts[c] = command.count;
+				batch.offsets[c] = (const void*)(command.firstIndex * sizeof(unsigned int));
+			}
+		}
+#ifdef GL_VERSION_4_3
+		if (indirectBuffer) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, drawCommands.size() * sizeof(DrawElementsIndirectCommand), &drawCommands[0]);
+		}
+#endif
+	}
+
+	//one multi-draw per material: the material's textures are bound once, then all its meshes are drawn.
+	//uses glMultiDrawElementsIndirect (GL 4.3) with the command buffer on the GPU,
+	//otherwise glMultiDrawElementsBaseVertex (GL 3.2) with the same ranges from CPU arrays.
+	void drawBatched(Shader& shader) {
+		if (batches.empty()) buildBatches();
+		updateCommandLODs();
+		for (unsigned int c = 0; c < drawCommands.size(); c++) trianglesSubmitted += drawCommands[c].count / 3;
+#ifdef GL_VERSION_4_3
+		if (indirectBuffer) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+#endif
+		for (unsigned int i = 0; i < batches.size(); i++) {
+			const MaterialBatch& batch = batches[i];
+			//skip materials whose meshes are all culled
+			unsigned int c = 0;
+			while (c < batch.commandCount && batch.counts[c] == 0) c++;
+			if (c == batch.commandCount) continue;
+			placeNode(shader, batch.node);
+			meshes[batch.meshIndex].bindTextures(shader);
+#ifdef GL_VERSION_4_3
+			if (indirectBuffer) {
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+					batch.commandCount, sizeof(DrawElementsIndirectCommand));
+				drawCalls++;
+				continue;
+			}
+#endif
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, &batch.counts[0], GL_UNSIGNED_INT, (const void* const*)&batch.offsets[0],
+				batch.commandCount, (GLint*)&batch.baseVertices[0]);
+			drawCalls++;
+		}
+#ifdef GL_VERSION_4_3
+		if (indirectBuffer) glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#endif
+	}
+
+
+	//group the meshes by their texture set and node and build one draw command per mesh, ordered by group.
+	//(all meshes whose node currently sits at the model origin share a group per material: in a typical
+	//file that is every mesh, so a static hierarchy costs no extra draw calls)
+	void buildBatches() {
+		map<pair<unsigned int, vector<unsigned int>>, vector<unsigned int>> groups; //(node, texture ids) -> meshes
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			vector<unsigned int> material;
+			for (unsigned int t = 0; t < meshes[i].textures.size(); t++) material.push_back(meshes[i].textures[t].id);
+			unsigned int node = isIdentity(nodes.worlds[meshes[i].node]) ? SceneGraph::NO_PARENT : meshes[i].node;
+			groups[make_pair(node, material)].push_back(i);
+		}
+
+		drawCommands.clear();
+		batches.clear();
+		commandMeshes.clear();
+		for (auto group = groups.begin(); group != groups.end(); group++) {
+			MaterialBatch batch;
+			batch.meshIndex = group->second[0];
+			batch.node = group->first.first;
+			batch.firstCommand = (unsigned int)drawCommands.size();
+			batch.commandCount = (unsigned int)group->second.size();
+			for (unsigned int i = 0; i < group->second.size(); i++) {
+				const Mesh& mesh = meshes[group->second[i]];
+				DrawElementsIndirectCommand command;
+				command.count = mesh.indexCount;
+				command.instanceCount = 1;
+				command.firstIndex = mesh.firstIndex;
+				command.baseVertex = mesh.baseVertex;
+				command.baseInstance = 0;
+				drawCommands.push_back(command);
+				commandMeshes.push_back(group->second[i]);
+
+				batch.counts.push_back(mesh.indexCount);
+				batch.offsets.push_back((const void*)(mesh.firstIndex * sizeof(unsigned int)));
+				batch.baseVertices.push_back(mesh.baseVertex);
+			}
+			batches.push_back(batch);
+		}
+		commandLODs.assign(drawCommands.size(), 0);
+
+#ifdef GL_VERSION_4_3
+		if (GLAD_GL_VERSION_4_3 && !drawCommands.empty()) {
+			if (!indirectBuffer) glGenBuffers(1, &indirectBuffer);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, drawCommands.size() * sizeof(DrawElementsIndirectCommand), &drawCommands[0], GL_STATIC_DRAW);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+#endif
+	}
+
+
+
 	//load the model data into a data structure of ASSIMP-scene obj.(the route obj of ASSIMP's data interface)
 	//have the scene obj -> can access all the data from the laded model.
 	void loadModel(string path) {
+		if (importModel(path)) setupArena();
+	}
+
+	//the CPU part of loadModel(): ASSIMP import + meshes, nodes and texture list (the GL part is setupArena()).
+	//for an asynchronous load (loader set) it runs on a worker thread and makes no GL call: the textures are only noted.
+	//returns false if the file can't be imported
+	bool importModel(const string& path) {
 		//read file via ASSIMP
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace );
@@ -103,20 +497,256 @@ private:
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 			//└check if the scene or the root node of the scene are null and check its flags return incomplete data
 			cout << "(Model.h 104)★ERROR::ASSIMP::" << importer.GetErrorString() << endl;
-			return;
+			return false;
 		}
 		//directory path of the given file path
 		directory = path.substr(0, path.find_last_of('/'));
+
+		//decode every texture the materials reference up front, so processNode only finds them in textures_loaded
+		if (parallelTextures) {
+			const aiTextureType types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT };
+			const char* typeNames[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+
+			vector<Texture> wanted;
+			for (unsigned int m = 0; m < scene->mNumMaterials; m++) {
+				aiMaterial* material = scene->mMaterials[m];
+				for (unsigned int t = 0; t < 4; t++) {
+					for (unsigned int i = 0; i < material->GetTextureCount(types[t]); i++) {
+						aiString str;
+						material->GetTexture(types[t], i, &str);
+						Texture texture;
+						texture.id = 0;
+						texture.type = typeNames[t];
+						texture.path = str.C_Str();
+						wanted.push_back(texture);
+					}
+				}
+			}
+			if (loader) reserveTextures(wanted);
+			else loadTextures(wanted);
+		}
 		
-		processNode(scene->mRootNode, scene);
+		nodes.reserve(countNodes(scene->mRootNode));
+		processNode(scene->mRootNode, scene, SceneGraph::NO_PARENT);
+		if (optimizeMeshes) optimizeReport.print();
+		return true;
+	}
+
+
+	//copy the vertices/indices of every mesh into the shared arena buffers
+	//and turn each mesh into a baseVertex/firstIndex range of them
+	void setupArena() {
+		size_t vertexCount = 0, indexCount = 0;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			meshes[i].baseVertex = (int)vertexCount;
+			meshes[i].firstIndex = (unsigned int)indexCount;
+			vertexCount += meshes[i].vertices.size();
+			indexCount += meshes[i].indices.size();
+		}
+
+		createArena(vertexCount, indexCount);
+		size_t stride = vertexSize(vertexFormat);
+		vector<PackedVertex> packed;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			Mesh& mesh = meshes[i];
+			mesh.VAO = VAO;
+			mesh.format = vertexFormat;
+			if (mesh.vertices.empty() || mesh.indices.empty()) continue;
+			const void* data = &mesh.vertices[0];
+			if (vertexFormat == VERTEX_PACKED) {
+				packVertices(&mesh.vertices[0], mesh.vertices.size(), packed);
+				data = &packed[0];
+			}
+			glBufferSubData(GL_ARRAY_BUFFER, mesh.baseVertex * stride, mesh.vertices.size() * stride, data);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, mesh.firstIndex * sizeof(unsigned int), mesh.indices.size() * sizeof(unsigned int), &mesh.indices[0]);
+		}
+		GLState::instance().bindVertexArray(0);
+	}
+
+
+	//allocate the arena buffers (optionally filled from memory, vertexData in vertexFormat) and declare the vertex layout.
+	//leaves the VAO bound, so the EBO binding stays recorded in it.
+	void createArena(size_t vertexCount, size_t indexCount, const void* vertexData = nullptr, const unsigned int* indexData = nullptr) {
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		GLState::instance().bindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		vertexBytes = vertexCount * vertexSize(vertexFormat);
+		glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+		Mesh::setupVertexAttributes(vertexFormat);
+	}
+
+
+	//load a model written by the BakeModel tool: map the file and upload the buffers straight from the mapping.
+	//no text parsing, no ASSIMP post-processing, no per-vertex conversion.
+	//(the baked vertex/index sections already are the arena layout, so each one is a single upload;
+	//a packed model converts the mapped vertices once instead)
+	void loadBaked(string path) {
+		if (readBaked(path)) uploadBaked();
+	}
+
+	//the CPU part of loadBaked(): map and validate the file, build the meshes and nodes, convert the vertices if packed.
+	//the mapping stays open for uploadBaked(). (no GL call for an asynchronous load, see importModel())
+	bool readBaked(const string& path) {
+		bakedFile.reset(new BakedModel(path));
+		const BakedModel& baked = *bakedFile;
+		if (!baked.valid()) {
+			bakedFile.reset();
+			return false;
+		}
+		directory = path.substr(0, path.find_last_of('/'));
+
+		vector<Texture> slots(baked.header->textureCount);
+		for (unsigned int i = 0; i < slots.size(); i++) {
+			slots[i].id = 0;
+			slots[i].type = baked.textures[i].type;
+			slots[i].path = baked.textures[i].path;
+		}
+		if (parallelTextures) {
+			if (loader) reserveTextures(slots);
+			else loadTextures(slots);
+		}
+
+		if (vertexFormat == VERTEX_PACKED) packVertices(baked.vertices, baked.header->vertexCount, bakedPacked);
+
+		//the baked hierarchy (a file without one places every mesh at the origin)
+		for (unsigned int i = 0; i < baked.header->nodeCount; i++) {
+			glm::mat4 local;
+			memcpy(&local[0][0], baked.nodes[i].local, sizeof(baked.nodes[i].local));
+			nodes.addNode(baked.nodes[i].parent, local, baked.nodes[i].name);
+		}
+		if (nodes.size() == 0) nodes.addNode(SceneGraph::NO_PARENT, glm::mat4(1.0f), "root");
+
+		meshes.reserve(baked.header->meshCount);
+		for (unsigned int i = 0; i < baked.header->meshCount; i++) {
+			const BakedMesh& mesh = baked.meshes[i];
+			vector<Texture> textures;
+			for (unsigned int t = mesh.firstTexture; t < mesh.firstTexture + mesh.textureCount; t++) {
+				auto loaded = textureIndex.find(textureKey(slots[t].path, slots[t].type));
+				if (loaded == textureIndex.end()) {
+					//serial path: load it here like loadMaterialTextures() does
+					slots[t].id = TextureFromFile(slots[t].path.c_str(), directory, gammaCorrection, slots[t].type == "texture_normal");
+					textureIndex[textureKey(slots[t].path, slots[t].type)] = textures_loaded.size();
+					textures_loaded.push_back(slots[t]);
+					textures.push_back(slots[t]);
+				}
+				else textures.push_back(textures_loaded[loaded->second]);
+			}
+			//(VAO: filled in by uploadBaked())
+			meshes.push_back(Mesh(textures, 0, (int)mesh.firstVertex, (unsigned int)mesh.firstIndex, (unsigned int)mesh.indexCount, vertexFormat));
+			meshes.back().node = mesh.node < nodes.size() ? mesh.node : 0;
+			if (mesh.lodCount) {
+				vector<MeshLOD> levels(mesh.lodCount);
+				for (unsigned int l = 0; l < mesh.lodCount; l++) {
+					const BakedLOD& lod = baked.lods[mesh.firstLOD + l];
+					levels[l].firstIndex = lod.firstIndex;
+					levels[l].indexCount = lod.indexCount;
+					levels[l].error = lod.error;
+				}
+				meshes.back().setLODs(levels);
+			}
+			meshes.back().computeBounds(baked.vertices + mesh.firstVertex, (size_t)mesh.vertexCount);
+		}
+		return true;
+	}
+
+	//the GL part of loadBaked(): the baked vertex/index sections already are the arena layout, so each one is a single upload
+	//straight from the mapping (or from the packed copy). the file is unmapped after it.
+	void uploadBaked() {
+		const BakedModel& baked = *bakedFile;
+		const void* vertexData = baked.vertices;
+		if (vertexFormat == VERTEX_PACKED) vertexData = bakedPacked.empty() ? nullptr : &bakedPacked[0];
+		createArena(baked.header->vertexCount, baked.header->indexCount, vertexData, baked.indices);
+		GLState::instance().bindVertexArray(0);
+		for (unsigned int i = 0; i < meshes.size(); i++) meshes[i].VAO = VAO;
+		bakedFile.reset();
+		vector<PackedVertex>().swap(bakedPacked);
+	}
+
+
+	//load every not yet loaded texture file of the list: decode them on the worker pool 
+	//and upload each one as soon as its decode finishes (uploads stay on this GL thread).
+	//streamTextures: only request them, they fill in over the next frames
+	void loadTextures(const vector<Texture>& wanted) {
+		TextureCache& cache = TextureCache::instance();
+		if (streamTextures) {
+			reserveTextures(wanted);
+			resolveTextures();
+			return;
+		}
+		TextureDecodePool pool;
+		unordered_map<string, size_t> submitted; //cache key -> slot whose decode is pending (two spellings of one file decode once)
+		vector<pair<size_t, size_t>> sameFile;   //(slot, slot it waits for): gets the texture of the other one on upload
+		for (unsigned int i = 0; i < wanted.size(); i++) {
+			if (textureIndex.count(textureKey(wanted[i].path, wanted[i].type))) continue;
+
+			//reserve the slot now so textures_loaded keeps the material order, the id is filled in on upload
+			textureIndex[textureKey(wanted[i].path, wanted[i].type)] = textures_loaded.size();
+			textures_loaded.push_back(wanted[i]);
+
+			//another Model may already have it, then there is nothing to decode
+			string filename = directory + '/' + wanted[i].path;
+			bool normalMap = wanted[i].type == "texture_normal";
+			if (cache.acquire(filename, gammaCorrection, normalMap, textures_loaded.back().id)) continue;
+			auto pending = submitted.emplace(cache.key(filename, gammaCorrection, normalMap), textures_loaded.size() - 1);
+			if (!pending.second) sameFile.push_back(make_pair(textures_loaded.size() - 1, pending.first->second));
+			else pool.submit(filename, textures_loaded.size() - 1, (gammaCorrection ? MIP_SRGB : 0) | (normalMap ? MIP_NORMAL_MAP : 0));
+		}
+
+		DecodedImage image;
+		while (pool.waitNext(image)) {
+			Texture& texture = textures_loaded[image.tag];
+			texture.id = cache.insert(image.path, gammaCorrection, texture.type == "texture_normal", uploadTexture(image, gammaCorrection));
+		}
+		//every slot holds its own reference (the destructor releases each one)
+		for (unsigned int i = 0; i < sameFile.size(); i++) {
+			Texture& texture = textures_loaded[sameFile[i].first];
+			cache.acquire(directory + '/' + texture.path, gammaCorrection, texture.type == "texture_normal", texture.id);
+		}
+	}
+
+	//textureIndex key of a texture: a normal map is loaded differently (renormalized mips),
+	//so it doesn't share the slot of a color texture of the same file
+	static string textureKey(const string& path, const string& type) {
+		return type == "texture_normal" ? path + "|normal" : path;
+	}
+
+	//worker side of an asynchronous load: only reserve the slots of the textures (id 0),
+	//so the meshes built next find them in textureIndex instead of loading them
+	void reserveTextures(const vector<Texture>& wanted) {
+		for (unsigned int i = 0; i < wanted.size(); i++) {
+			if (textureIndex.count(textureKey(wanted[i].path, wanted[i].type))) continue;
+			textureIndex[textureKey(wanted[i].path, wanted[i].type)] = textures_loaded.size();
+			textures_loaded.push_back(wanted[i]);
+		}
+	}
+
+	//GL side: stream the reserved textures and give the meshes' copies their ids
+	void resolveTextures() {
+		TextureCache& cache = TextureCache::instance();
+		for (unsigned int i = 0; i < textures_loaded.size(); i++)
+			if (!textures_loaded[i].id) textures_loaded[i].id = cache.stream(directory + '/' + textures_loaded[i].path, gammaCorrection, textures_loaded[i].type == "texture_normal");
+		for (unsigned int m = 0; m < meshes.size(); m++)
+			for (unsigned int t = 0; t < meshes[m].textures.size(); t++)
+				meshes[m].textures[t].id = textures_loaded[textureIndex[textureKey(meshes[m].textures[t].path, meshes[m].textures[t].type)]].id;
 	}
 
 
 	//ASSIMP's structure: each node contains a set of mesh index that points to a specific mesh in the secne object.
 	//retreive these mesh indices->retrueve each mesh->process each mesh->do this all again for each of the node's children nodes.
 	//
-	//recursive function process each node until all nodes have been processed
-	void processNode(aiNode* node, const aiScene* scene) {
+	//recursive function process each node until all nodes have been processed.
+	//every aiNode becomes a scene graph node (with its mTransformation), its meshes point at it
+	void processNode(aiNode* node, const aiScene* scene, unsigned int parent) {
+		//aiMatrix4x4 is row major (a1 a2 a3 a4 = first row), glm is column major
+		const aiMatrix4x4& m = node->mTransformation;
+		glm::mat4 local(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+		unsigned int index = nodes.addNode(parent, local, node->mName.C_Str());
+
 		//process all the node's meshes 
 		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
 			//first check each of the node's mesh index 
@@ -125,10 +755,25 @@ private:
 			//the returned mesh is passed to the processMesh()
 			/*processMesh(): returns a mesh object that we can store in the meshes list/vector*/
 			meshes.push_back(processMesh(mesh, scene));
+			meshes.back().node = index;
 		}
 
 		//then do the same for each of its children
-		for (unsigned int i = 0; i < node->mNumChildren; i++) processNode(node->mChildren[i], scene);
+		for (unsigned int i = 0; i < node->mNumChildren; i++) processNode(node->mChildren[i], scene, index);
+	}
+
+
+	static size_t countNodes(const aiNode* node) {
+		size_t count = 1;
+		for (unsigned int i = 0; i < node->mNumChildren; i++) count += countNodes(node->mChildren[i]);
+		return count;
+	}
+
+	static bool isIdentity(const glm::mat4& m) {
+		for (int column = 0; column < 4; column++)
+			for (int row = 0; row < 4; row++)
+				if (m[column][row] != (column == row ? 1.0f : 0.0f)) return false;
+		return true;
 	}
 
 
@@ -204,6 +849,19 @@ private:
 			//retrieve all indices of the face and store them in the indices vector
 			for (unsigned int j = 0; j < face.mNumIndices; j++) indices.push_back(face.mIndices[j]);
 		}
+		//reorder the file-order triangles/vertices for the vertex cache, overdraw and vertex fetch
+		bool triangles = mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE;
+		if (optimizeMeshes && triangles) optimizeReport.add(optimizeMesh(vertices, indices));
+		//simplified levels, appended to indices
+		vector<MeshLOD> levels;
+		if (buildLODs && triangles) {
+			generateLODs(vertices, indices, levels);
+			for (unsigned int l = 1; l < levels.size() && optimizeMeshes; l++) {
+				vector<unsigned int> level(indices.begin() + levels[l].firstIndex, indices.begin() + levels[l].firstIndex + levels[l].indexCount);
+				optimizeVertexCache(level, vertices.size());
+				std::copy(level.begin(), level.end(), indices.begin() + levels[l].firstIndex);
+			}
+		}
 
 		/*process material 
 		To retrieve the material of a mesh, we need to index the scene's mMaterials[] array.
@@ -232,7 +890,10 @@ private:
 			textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 			//return a mesh object created from the resultant mesh data
-			return Mesh(vertices, indices, textures);
+			//(not uploaded on its own: setupArena() puts it into the model's shared buffers)
+			Mesh result(vertices, indices, textures, false);
+			result.setLODs(levels);
+			return result;
 		}
 	}
 
@@ -247,23 +908,17 @@ private:
 			aiString str;
 			mat->GetTexture(type, i, &str);
 					//└retrieve each of the texture's file location(stores the result in an aiString)
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-					textures.push_back(textures_loaded[j]);
-					skip = true;
-					break;
-				}
-			}
-
-			if (!skip) {
+			auto loaded = textureIndex.find(textureKey(str.C_Str(), typeName));
+			if (loaded != textureIndex.end()) textures.push_back(textures_loaded[loaded->second]);
+			else {
 				//if texture hasn't been loaded already, load it
 				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), directory);
+				texture.id = TextureFromFile(str.C_Str(), directory, gammaCorrection, typeName == "texture_normal");
 				//└loads a texture with "stb_image.h"
 				texture.type = typeName;
 				texture.path = str.C_Str();//assumption that texture file paths in model files are local to the actual model oject
 				textures.push_back(texture);
+				textureIndex[textureKey(texture.path, typeName)] = textures_loaded.size();
 				textures_loaded.push_back(texture); 
 				//└store it as texture loaded for entire model, to won't unnecessary load duplicate textures.
 			}			
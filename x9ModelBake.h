@@ -0,0 +1,371 @@
+/*Pre-baked binary model format (.xmdl).
+* Assimp re-parses the OBJ text and re-runs Triangulate/GenSmoothNormals/CalcTangentSpace on every launch.
+* A baked file stores the Model's final Vertex/index/texture data exactly like it sits in memory,
+* so loading it is: map the file, check the header, checksum and ranges, hand the pointers to glBufferData.
+*
+* layout (every section starts 16 byte aligned):
+*   BakedHeader
+*   BakedMesh[meshCount]
+*   BakedTexture[textureCount]     texture slots of all meshes, BakedMesh::firstTexture indexes into it
+*   BakedLOD[lodCount]             levels of detail of all meshes, BakedMesh::firstLOD indexes into it
+*   BakedNode[nodeCount]           the node hierarchy (parents first), BakedMesh::node indexes into it
+*   Vertex[vertexCount]            vertices of all meshes back to back
+*   unsigned int[indexCount]       indices of all meshes back to back (relative to the mesh's first vertex, all LODs of a mesh)
+* the checksum covers the header (up to the checksum field) and everything after it.
+* every count and first* index is range checked on load: a damaged or hostile file is rejected, never read out of bounds.*/
+
+#ifndef MODEL_BAKE_H
+#define MODEL_BAKE_H
+
+#include "Mesh.h"
+#include "SceneGraph.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+const char BAKED_MAGIC[4] = { 'X', 'M', 'D', 'L' };
+const uint32_t BAKED_VERSION = 4; //bump whenever the layout or struct Vertex changes
+
+struct BakedHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexSize;   //sizeof(Vertex) of the baker, a mismatch means the file is stale
+	uint32_t meshCount;
+	uint32_t textureCount;
+	uint32_t lodCount;
+	uint32_t nodeCount;
+	uint32_t reserved;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t payloadSize;  //bytes after the header
+	uint64_t checksum;     //bakedChecksum() of the header fields above and the payload
+};
+
+struct BakedMesh {
+	uint64_t firstVertex, vertexCount;
+	uint64_t firstIndex, indexCount;
+	uint32_t firstTexture, textureCount;
+	uint32_t firstLOD, lodCount; //lodCount 0: indexCount indices of one level
+	uint32_t node;               //scene graph node that places the mesh
+	uint32_t reserved;
+};
+
+struct BakedLOD {
+	uint32_t firstIndex, indexCount; //relative to the mesh's firstIndex
+	float error;
+	uint32_t reserved;
+};
+
+struct BakedNode {
+	uint32_t parent;  //SceneGraph::NO_PARENT for a root
+	uint32_t reserved[3];
+	float local[16];  //column major, relative to the parent
+	char name[48];
+};
+
+struct BakedTexture {
+	char type[32];  //"texture_diffuse", ...
+	char path[224]; //relative to the model's directory, like in the source file
+};
+
+//round up to the next 16 byte boundary
+inline uint64_t bakedAlign(uint64_t offset) { return (offset + 15) & ~(uint64_t)15; }
+
+//FNV-1a style hash over 8 byte words (the byte-wise version is too slow for a few hundred MB)
+//(seed: the hash of the bytes before data, to continue a checksum over a second block)
+inline uint64_t checksum64(const unsigned char* data, uint64_t size, uint64_t seed = 14695981039346656037ull) {
+	uint64_t hash = seed;
+	uint64_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	for (; i < size; i++) hash = (hash ^ data[i]) * 1099511628211ull;
+	return hash;
+}
+
+//checksum of a baked file: the header up to its checksum field, then the payload
+inline uint64_t bakedChecksum(const BakedHeader& header, const unsigned char* payload) {
+	uint64_t hash = checksum64((const unsigned char*)&header, offsetof(BakedHeader, checksum));
+	return checksum64(payload, header.payloadSize, hash);
+}
+
+
+
+
+
+//read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	const unsigned char* data;
+	uint64_t size;
+
+	MappedFile(const string& path) : data(nullptr), size(0) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		mapping = NULL;
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER fileSize;
+		GetFileSizeEx(file, &fileSize);
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) return;
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data) size = (uint64_t)fileSize.QuadPart;
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED) {
+				data = (const unsigned char*)mapped;
+				size = (uint64_t)info.st_size;
+			}
+		}
+		close(fd); //the mapping keeps its own reference to the file
+#endif
+	}
+
+	~MappedFile() {
+#ifdef _WIN32
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data) munmap((void*)data, (size_t)size);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+#ifdef _WIN32
+	HANDLE file, mapping;
+#endif
+};
+
+
+
+//a validated view into a mapped .xmdl file (pointers stay valid while the view lives)
+class BakedModel
+{
+public:
+	const BakedHeader* header;
+	const BakedMesh* meshes;
+	const BakedTexture* textures;
+	const BakedLOD* lods;
+	const BakedNode* nodes;
+	const Vertex* vertices;
+	const unsigned int* indices;
+
+	BakedModel(const string& path) : header(nullptr), meshes(nullptr), textures(nullptr), lods(nullptr), nodes(nullptr), vertices(nullptr), indices(nullptr), file(path) {
+		if (!file.data) {
+			cout << "(ModelBake.h)★ERROR::BAKED::cannot map " << path << endl;
+			return;
+		}
+		if (file.size < sizeof(BakedHeader)) {
+			cout << "(ModelBake.h)★ERROR::BAKED::truncated file " << path << endl;
+			return;
+		}
+
+		const BakedHeader* candidate = (const BakedHeader*)file.data;
+		if (memcmp(candidate->magic, BAKED_MAGIC, 4) != 0 || candidate->version != BAKED_VERSION || candidate->vertexSize != sizeof(Vertex)) {
+			cout << "(ModelBake.h)★ERROR::BAKED::wrong magic/version/vertex layout in " << path << ", re-bake it" << endl;
+			return;
+		}
+		uint64_t payloadStart = bakedAlign(sizeof(BakedHeader));
+		if (payloadStart + candidate->payloadSize != file.size) {
+			cout << "(ModelBake.h)★ERROR::BAKED::size mismatch in " << path << endl;
+			return;
+		}
+		if (bakedChecksum(*candidate, file.data + payloadStart) != candidate->checksum) {
+			cout << "(ModelBake.h)★ERROR::BAKED::checksum mismatch in " << path << endl;
+			return;
+		}
+
+		//sections follow each other in the order of the layout comment above, all of them inside the payload
+		uint64_t offset = payloadStart;
+		const BakedMesh* meshSection = (const BakedMesh*)section(offset, candidate->meshCount, sizeof(BakedMesh));
+		const BakedTexture* textureSection = (const BakedTexture*)section(offset, candidate->textureCount, sizeof(BakedTexture));
+		const BakedLOD* lodSection = (const BakedLOD*)section(offset, candidate->lodCount, sizeof(BakedLOD));
+		const BakedNode* nodeSection = (const BakedNode*)section(offset, candidate->nodeCount, sizeof(BakedNode));
+		const Vertex* vertexSection = (const Vertex*)section(offset, candidate->vertexCount, sizeof(Vertex));
+		const unsigned int* indexSection = (const unsigned int*)section(offset, candidate->indexCount, sizeof(unsigned int));
+		if (!meshSection || !textureSection || !lodSection || !nodeSection || !vertexSection || !indexSection) {
+			cout << "(ModelBake.h)★ERROR::BAKED::section outside the payload in " << path << endl;
+			return;
+		}
+		if (!entriesInRange(*candidate, meshSection, textureSection, lodSection, nodeSection, indexSection)) {
+			cout << "(ModelBake.h)★ERROR::BAKED::mesh/texture/LOD/node entry out of range in " << path << endl;
+			return;
+		}
+
+		meshes = meshSection;
+		textures = textureSection;
+		lods = lodSection;
+		nodes = nodeSection;
+		vertices = vertexSection;
+		indices = indexSection;
+		header = candidate;
+	}
+
+	bool valid() const { return header != nullptr; }
+
+private:
+	MappedFile file;
+
+	//the section of count elements at offset, then offset moves to the next one. nullptr if it would end past the file
+	//(file.size == the end of the payload, checked before)
+	const unsigned char* section(uint64_t& offset, uint64_t count, uint64_t elementSize) const {
+		if (offset > file.size || count > (file.size - offset) / elementSize) return nullptr;
+		const unsigned char* start = file.data + offset;
+		offset = bakedAlign(offset + count * elementSize);
+		return start;
+	}
+
+	//every first* + count stays inside its section, LODs inside their mesh, indices inside their mesh's vertices,
+	//nodes only point at earlier parents and the strings are terminated
+	static bool entriesInRange(const BakedHeader& header, const BakedMesh* meshes, const BakedTexture* textures, const BakedLOD* lods, const BakedNode* nodes, const unsigned int* indices) {
+		for (uint32_t i = 0; i < header.meshCount; i++) {
+			const BakedMesh& mesh = meshes[i];
+			if (mesh.vertexCount > header.vertexCount || mesh.firstVertex > header.vertexCount - mesh.vertexCount) return false;
+			if (mesh.indexCount > header.indexCount || mesh.firstIndex > header.indexCount - mesh.indexCount) return false;
+			if (mesh.textureCount > header.textureCount || mesh.firstTexture > header.textureCount - mesh.textureCount) return false;
+			if (mesh.lodCount > header.lodCount || mesh.firstLOD > header.lodCount - mesh.lodCount) return false;
+			if (header.nodeCount ? mesh.node >= header.nodeCount : mesh.node != 0) return false; //(a file without nodes writes 0)
+			for (uint32_t l = mesh.firstLOD; l < mesh.firstLOD + mesh.lodCount; l++)
+				if (lods[l].indexCount > mesh.indexCount || lods[l].firstIndex > mesh.indexCount - lods[l].indexCount) return false;
+			for (uint64_t n = mesh.firstIndex; n < mesh.firstIndex + mesh.indexCount; n++)
+				if (indices[n] >= mesh.vertexCount) return false;
+		}
+		for (uint32_t i = 0; i < header.textureCount; i++)
+			if (textures[i].type[sizeof(textures[i].type) - 1] != 0 || textures[i].path[sizeof(textures[i].path) - 1] != 0) return false;
+		for (uint32_t i = 0; i < header.nodeCount; i++)
+			if ((nodes[i].parent != SceneGraph::NO_PARENT && nodes[i].parent >= i) || nodes[i].name[sizeof(nodes[i].name) - 1] != 0) return false;
+		return true;
+	}
+};
+
+
+
+//write the meshes of a loaded Model into a .xmdl file.
+//(needs the CPU copies: vertices/indices of meshes that were loaded through Assimp)
+//nodeList: the model's hierarchy, nullptr bakes none (the meshes load at the origin)
+bool writeBakedModel(const string& path, const vector<Mesh>& meshList, const SceneGraph* nodeList = nullptr) {
+	vector<BakedMesh> bakedMeshes;
+	vector<BakedTexture> bakedTextures;
+	vector<BakedLOD> bakedLODs;
+	vector<BakedNode> bakedNodes;
+	uint64_t vertexCount = 0, indexCount = 0;
+
+	for (unsigned int i = 0; i < meshList.size(); i++) {
+		const Mesh& mesh = meshList[i];
+		BakedMesh baked;
+		baked.firstVertex = vertexCount;
+		baked.vertexCount = mesh.vertices.size();
+		baked.firstIndex = indexCount;
+		baked.indexCount = mesh.indices.size();
+		baked.firstTexture = (uint32_t)bakedTextures.size();
+		baked.textureCount = (uint32_t)mesh.textures.size();
+		baked.firstLOD = (uint32_t)bakedLODs.size();
+		baked.lodCount = (uint32_t)mesh.lods.size();
+		baked.node = nodeList ? mesh.node : 0;
+		baked.reserved = 0;
+		bakedMeshes.push_back(baked);
+
+		for (unsigned int l = 0; l < mesh.lods.size(); l++) {
+			BakedLOD lod;
+			lod.firstIndex = mesh.lods[l].firstIndex;
+			lod.indexCount = mesh.lods[l].indexCount;
+			lod.error = mesh.lods[l].error;
+			lod.reserved = 0;
+			bakedLODs.push_back(lod);
+		}
+
+		for (unsigned int t = 0; t < mesh.textures.size(); t++) {
+			BakedTexture texture;
+			memset(&texture, 0, sizeof(texture));
+			strncpy(texture.type, mesh.textures[t].type.c_str(), sizeof(texture.type) - 1);
+			strncpy(texture.path, mesh.textures[t].path.c_str(), sizeof(texture.path) - 1);
+			bakedTextures.push_back(texture);
+		}
+		vertexCount += mesh.vertices.size();
+		indexCount += mesh.indices.size();
+	}
+
+	for (unsigned int i = 0; nodeList && i < nodeList->size(); i++) {
+		BakedNode node;
+		memset(&node, 0, sizeof(node));
+		node.parent = nodeList->parents[i];
+		memcpy(node.local, &nodeList->locals[i][0][0], sizeof(node.local));
+		strncpy(node.name, nodeList->names[i].c_str(), sizeof(node.name) - 1);
+		bakedNodes.push_back(node);
+	}
+
+	//assemble the payload in memory, then hash it
+	uint64_t meshOffset = 0;
+	uint64_t textureOffset = bakedAlign(meshOffset + bakedMeshes.size() * sizeof(BakedMesh));
+	uint64_t lodOffset = bakedAlign(textureOffset + bakedTextures.size() * sizeof(BakedTexture));
+	uint64_t nodeOffset = bakedAlign(lodOffset + bakedLODs.size() * sizeof(BakedLOD));
+	uint64_t vertexOffset = bakedAlign(nodeOffset + bakedNodes.size() * sizeof(BakedNode));
+	uint64_t indexOffset = bakedAlign(vertexOffset + vertexCount * sizeof(Vertex));
+	uint64_t payloadSize = bakedAlign(indexOffset + indexCount * sizeof(unsigned int));
+
+	vector<unsigned char> payload(payloadSize, 0);
+	if (!bakedMeshes.empty()) memcpy(&payload[meshOffset], &bakedMeshes[0], bakedMeshes.size() * sizeof(BakedMesh));
+	if (!bakedTextures.empty()) memcpy(&payload[textureOffset], &bakedTextures[0], bakedTextures.size() * sizeof(BakedTexture));
+	if (!bakedLODs.empty()) memcpy(&payload[lodOffset], &bakedLODs[0], bakedLODs.size() * sizeof(BakedLOD));
+	if (!bakedNodes.empty()) memcpy(&payload[nodeOffset], &bakedNodes[0], bakedNodes.size() * sizeof(BakedNode));
+	for (unsigned int i = 0; i < meshList.size(); i++) {
+		const Mesh& mesh = meshList[i];
+		if (!mesh.vertices.empty())
+			memcpy(&payload[vertexOffset + bakedMeshes[i].firstVertex * sizeof(Vertex)], &mesh.vertices[0], mesh.vertices.size() * sizeof(Vertex));
+		if (!mesh.indices.empty())
+			memcpy(&payload[indexOffset + bakedMeshes[i].firstIndex * sizeof(unsigned int)], &mesh.indices[0], mesh.indices.size() * sizeof(unsigned int));
+	}
+
+	BakedHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, BAKED_MAGIC, 4);
+	header.version = BAKED_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.meshCount = (uint32_t)bakedMeshes.size();
+	header.textureCount = (uint32_t)bakedTextures.size();
+	header.lodCount = (uint32_t)bakedLODs.size();
+	header.nodeCount = (uint32_t)bakedNodes.size();
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.payloadSize = payloadSize;
+	header.checksum = bakedChecksum(header, payload.data());
+
+	ofstream out(path, ios::binary);
+	if (!out) {
+		cout << "(ModelBake.h)★ERROR::BAKED::cannot write " << path << endl;
+		return false;
+	}
+	vector<char> headerBlock(bakedAlign(sizeof(BakedHeader)), 0);
+	memcpy(headerBlock.data(), &header, sizeof(header));
+	out.write(headerBlock.data(), headerBlock.size());
+	out.write((const char*)payload.data(), payload.size());
+	return (bool)out;
+}
+#endif // !MODEL_BAKE_H
@@ -0,0 +1,145 @@
+/*Asynchronous Model loading.
+* The Model constructor imports the file (ASSIMP), converts and optimizes the meshes and uploads everything before it returns,
+* so the render loop stands still until the biggest model is done.
+* ModelLoader runs the CPU part of a load on its worker threads and queues the GL part (buffers, textures) for the GL thread,
+* which picks it up in poll() between frames:
+*   ModelLoader loader;
+*   Model a(loader, "backpack/backpack.obj"), b(loader, "tree/tree.xmdl");   both return at once, the files load side by side
+*   ... render loop:
+*   loader.poll();                       once per frame, on the GL thread
+*   a.Draw(shader, ...);                 draws nothing until a.ready()
+* The loader knows nothing about Model: a job is a piece of work for a worker thread and an upload for the GL thread,
+* tagged with the object that owns them (cancel(owner) when the owner goes away before its upload).*/
+
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+class ModelLoader
+{
+public:
+	//threadCount 0 -> one worker per hardware thread
+	ModelLoader(unsigned int threadCount = 0) : stopping(false) {
+		if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0) threadCount = 4; //hardware_concurrency() may return 0 if unknown
+		for (unsigned int i = 0; i < threadCount; i++) workers.emplace_back(&ModelLoader::workerLoop, this);
+	}
+
+	//the loads still running are finished: their owners get complete models even if nobody polled
+	~ModelLoader() {
+		finish();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		workReady.notify_all();
+		for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+	}
+	ModelLoader(const ModelLoader&) = delete;
+	ModelLoader& operator=(const ModelLoader&) = delete;
+
+	//queue a load: work() runs on a worker thread (no GL calls), then upload() on the GL thread in poll()/finish()
+	void submit(const void* owner, std::function<void()> work, std::function<void()> upload) {
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			queued.push_back(Job{ owner, std::move(work), std::move(upload) });
+		}
+		workReady.notify_one();
+	}
+
+	//run the uploads of up to maxUploads finished loads (GL thread, never waits for a worker).
+	//a big model is one upload: keeping it to one per frame spreads several models over several frames.
+	//returns true when nothing is left to load
+	bool poll(unsigned int maxUploads = 1) {
+		for (unsigned int i = 0; i < maxUploads; i++) {
+			Job job;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				if (finished.empty()) break;
+				job = std::move(finished.front());
+				finished.pop_front();
+			}
+			job.upload();
+		}
+		return pending() == 0;
+	}
+
+	//wait for every load and upload it
+	void finish() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				jobDone.wait(lock, [this] { return !finished.empty() || (queued.empty() && running.empty()); });
+				if (finished.empty()) return;
+				job = std::move(finished.front());
+				finished.pop_front();
+			}
+			job.upload();
+		}
+	}
+
+	//forget the loads of owner (GL thread): queued ones never run, a running one is waited for, a finished one isn't uploaded
+	void cancel(const void* owner) {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		queued.erase(std::remove_if(queued.begin(), queued.end(), [owner](const Job& job) { return job.owner == owner; }), queued.end());
+		jobDone.wait(lock, [this, owner] { return std::find(running.begin(), running.end(), owner) == running.end(); });
+		finished.erase(std::remove_if(finished.begin(), finished.end(), [owner](const Job& job) { return job.owner == owner; }), finished.end());
+	}
+
+	//loads submitted and not uploaded yet
+	size_t pending() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		return queued.size() + running.size() + finished.size();
+	}
+
+	unsigned int threadCount() const { return (unsigned int)workers.size(); }
+
+
+
+private:
+	struct Job {
+		const void* owner;
+		std::function<void()> work;
+		std::function<void()> upload;
+	};
+	std::vector<std::thread> workers;
+	std::deque<Job> queued;              //waiting for a worker
+	std::vector<const void*> running;    //owners of the jobs the workers are on
+	std::deque<Job> finished;            //work done, waiting for poll()
+	bool stopping;
+	std::mutex queueMutex;
+	std::condition_variable workReady;
+	std::condition_variable jobDone;
+
+	void workerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				workReady.wait(lock, [this] { return stopping || !queued.empty(); });
+				if (queued.empty()) return;
+				job = std::move(queued.front());
+				queued.pop_front();
+				running.push_back(job.owner);
+			}
+
+			job.work(); //(outside the lock: the other workers load their models meanwhile)
+
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				running.erase(std::find(running.begin(), running.end(), job.owner));
+				finished.push_back(std::move(job));
+			}
+			jobDone.notify_all();
+		}
+	}
+};
+#endif // !MODEL_LOADER_H
@@ -1,11 +1,14 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <chrono>
 
 #include "Shader.h"
 #include "Camera.h"
 #include "Model.h"
 #include "filesystem.h"
+#include "RenderContext.h"
+#include "Profiler.h"
 
 //setting
 const unsigned int SCR_WIDTH = 1600;
@@ -71,87 +74,140 @@ void scroll(GLFWwindow* window, double xoffset, double yoffset) {
 
 
 
-int main()
+int main(int argc, char** argv)
 {
-	//glfw: initialize and configure
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	//glfw window creation
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Xion's OpenGL", NULL, NULL);
-	if (window == NULL) {
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, window_size_changed);
-	glfwSetCursorPosCallback(window, mouse_move);
-	glfwSetScrollCallback(window, scroll);
-
-	//tell GLFW to capture my mouse
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	//glad: load all OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+	//window, or an offscreen context with --headless (see RenderContext.h)
+	RenderOptions options = parseRenderOptions(argc, argv);
+	RenderContext renderContext(options, SCR_WIDTH, SCR_HEIGHT, "Xion's OpenGL");
+	if (!renderContext.ok()) return -1;
+	//--profile <file.csv|file.json>: time the regions below (see Profiler.h)
+	Profiler::instance().enabled = !options.profile.empty();
+	GLFWwindow* window = renderContext.window;
+	if (window) {
+		glfwSetFramebufferSizeCallback(window, window_size_changed);
+		glfwSetCursorPosCallback(window, mouse_move);
+		glfwSetScrollCallback(window, scroll);
+
+		//tell GLFW to capture my mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	//tell "stb_image.h" to flip loaded texture's on the y-axis (before loading model)
-	stbi_set_flip_vertically_on_load(true);
+	TextureCache::instance().setFlipVertically(true);
 
 	//configure global OpenGL state
 	glEnable(GL_DEPTH_TEST);
 
 	//build shader
-	Shader shader;
+	//(in the background: the driver compiles while the model loads, see ProgramBuilder.h)
+	ProgramBuilder programBuilder;
+	Shader shader(programBuilder);
 
 	//load models
-	Model xModel("backpack/backpack.obj");
+	//(backpack/backpack.xmdl written by the BakeModel tool loads the same model without ASSIMP)
+	//in the background: the import runs on a ModelLoader worker, the frames go on meanwhile and the model
+	//appears once loader.poll() has uploaded it (see ModelLoader.h)
+	ModelLoader modelLoader;
+	auto loadStart = std::chrono::steady_clock::now();
+	//(optimized triangle order + a level of detail chain per mesh, see MeshOptimizer.h/MeshSimplifier.h)
+	//(textures streamed: the model draws right away with their smallest mips, the rest arrives a few MB per frame)
+	ModelOptions modelOptions;
+	modelOptions.optimize = true;
+	modelOptions.lods = true;
+	Model xModel(modelLoader, "backpack/backpack.obj", modelOptions);
+	xModel.lodViewportHeight = (float)SCR_HEIGHT;
+	//submit the meshes grouped by material (one multi-draw per material instead of one draw per mesh)
+	xModel.drawMode = DRAW_BATCHED;
 
 	//draw in wireframe
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	//------------------------------------------
 	//render loop
-	while (!glfwWindowShouldClose(window)) {
+	while (renderContext.running()) {
 		//per-frame time logic
-		deltaTime = glfwGetTime() - lastFrame;
-		lastFrame = glfwGetTime();
+		deltaTime = renderContext.time() - lastFrame;
+		lastFrame = renderContext.time();
+		GLState::instance().beginFrame();
+		Profiler::instance().beginFrame();
 
 		//input
-		processInput(window);
+		{
+			ProfileScope scope("input");
+			if (window) processInput(window);
+		}
+
+		//upload a model that finished loading, and the next texture levels that finished decoding (at most 4 MB this frame)
+		{
+			ProfileScope scope("loading");
+			bool wasReady = xModel.ready();
+			modelLoader.poll();
+			if (xModel.ready() && !wasReady) {
+				//(request to ready: the "load model" region spans the frames drawn meanwhile)
+				auto loadEnd = std::chrono::steady_clock::now();
+				Profiler::instance().span("load model", loadStart, loadEnd);
+				std::cout << "model ready after " << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms, draw calls per frame: "
+					<< xModel.countDrawCalls(DRAW_PER_MESH) << " per mesh -> " << xModel.countDrawCalls(DRAW_BATCHED) << " batched" << std::endl;
+			}
+			TextureStreamer::instance().update(4.0f);
+		}
 
 		//render
 		glClearColor(.3f, .3f, .3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//enable shader before setting uniforms
-		shader.use();
+		//nothing to draw with until the shader is linked: show the cleared frame meanwhile
+		programBuilder.poll();
+		if (!shader.ready()) {
+			renderContext.endFrame();
+			continue;
+		}
 
-		//view/projection transformations
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 100.0f);;
-		glm::mat4 view = camera.GetViewMatrix();
-		shader.setMat4("projection", projection);
-		shader.setMat4("view", view);
+		//enable shader before setting uniforms
+		glm::mat4 model = glm::mat4(1.0f);
+		glm::mat4 projection;
+		{
+			ProfileScope scope("uniforms");
+			shader.use();
+
+			//view/projection transformations
+			projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, .1f, 100.0f);;
+			glm::mat4 view = camera.GetViewMatrix();
+			shader.setMat4("projection", projection);
+			shader.setMat4("view", view);
+
+			model = glm::translate(model, glm::vec3(.0f, .0f, .0f)); //translate it down so it's at the center of the scene
+			model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));  //it's a bit too big for our scene, so scale it down
+			shader.setMat4("model", model);
+		}
 
 		//render the loaded model
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(.0f, .0f, .0f)); //translate it down so it's at the center of the scene
-		model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));  //it's a bit too big for our scene, so scale it down
-		shader.setMat4("model", model);
-		xModel.Draw(shader);
+		{
+			ProfileScope scope("Model::Draw");
+			//(the level of each mesh follows its size on screen, meshes outside the view aren't drawn)
+			xModel.Draw(shader, camera, model, projection);
+		}
 
 		//glfw: swap buffers and poll IO events (key pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		//(headless: wait for the frame and record its time)
+		{
+			ProfileScope scope("swap");
+			renderContext.endFrame();
+		}
+	}
+	Profiler::instance().finish();
+	if (!options.profile.empty()) {
+		Profiler::instance().printSummary();
+		Profiler::instance().write(options.profile);
 	}
+	TextureCache::instance().printStats();
+	TextureStreamer::instance().printStats();
+	GLState::instance().printFrameStats();
+	std::cout << "model: " << xModel.drawCalls << " draw calls, " << xModel.trianglesSubmitted << " triangles, "
+		<< xModel.meshesVisible << " meshes visible, " << xModel.meshesCulled << " culled last frame" << std::endl;
 
 	//glfw: terminate, clearing all precviously allocated GLFW resources
-	glfwTerminate();
+	//(done by ~RenderContext, after the model has released its GL objects)
 	return 0;
 }
 
@@ -0,0 +1,254 @@
+/*Frame profiler: CPU + GPU time of named regions.
+*   Profiler::instance().beginFrame();          once per frame, at the top of the render loop
+*   { ProfileScope scope("Model::Draw"); xModel.Draw(shader); }
+* CPU time comes from steady_clock. GPU time comes from a GL_TIMESTAMP query at both ends of the region
+* (timestamps instead of GL_TIME_ELAPSED because elapsed-time queries can't nest, the regions can).
+* Reading a query result right away would wait for the GPU to catch up, so every frame has its own set of queries
+* in a ring of FRAME_LATENCY frames and a frame's results are read back FRAME_LATENCY frames later.
+* If they are still not ready then, the GPU times of that frame are dropped (gpuMs = -1) instead of stalling.
+* Scopes before the first beginFrame() (model loading, ...) belong to frame 0, a scope must not span a beginFrame().
+* Work that runs across frames (a background model load, ...) is timed by the caller and added with span(): CPU time only.*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+class Profiler
+{
+public:
+	static const unsigned int FRAME_LATENCY = 4; //frames in flight before a frame's queries are read
+	static const unsigned int MAX_REGIONS = 64;  //regions per frame (more are ignored)
+	static const unsigned int NO_REGION = 0xFFFFFFFFu;
+
+	//one finished region
+	struct Result {
+		unsigned int frame;
+		const char* name;
+		unsigned int depth;  //nesting level, 0 = top
+		double startMs;      //CPU start, relative to the profiler's creation
+		double cpuMs;
+		double gpuMs;        //-1: not available (dropped)
+	};
+
+	bool enabled; //off: begin()/end() return immediately
+
+	//one profiler per process (create it after the GL context)
+	static Profiler& instance() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	//close the current frame and start the next one
+	void beginFrame() {
+		if (!enabled) return;
+		current = (current + 1) % FRAME_LATENCY;
+		FrameSlot& slot = slots[current];
+		if (slot.regionCount) collect(slot, false);
+		slot.frame = ++frame;
+		slot.regionCount = 0;
+		depth = 0;
+	}
+
+	//start a region (prefer ProfileScope). name must outlive the profiler (a string literal)
+	unsigned int begin(const char* name) {
+		if (!enabled) return NO_REGION;
+		FrameSlot& slot = slots[current];
+		if (slot.regionCount == MAX_REGIONS) { overflow++; return NO_REGION; }
+		unsigned int index = slot.regionCount++;
+		Region& region = slot.regions[index];
+		region.name = name;
+		region.depth = depth++;
+		region.cpuBegin = std::chrono::steady_clock::now();
+		region.cpuEnd = region.cpuBegin;
+		region.cpuOnly = false;
+		glQueryCounter(slot.queries[2 * index], GL_TIMESTAMP);
+		slot.lastQuery = slot.queries[2 * index];
+		return index;
+	}
+
+	void end(unsigned int index) {
+		if (index == NO_REGION) return;
+		FrameSlot& slot = slots[current];
+		glQueryCounter(slot.queries[2 * index + 1], GL_TIMESTAMP);
+		slot.lastQuery = slot.queries[2 * index + 1];
+		slot.regions[index].cpuEnd = std::chrono::steady_clock::now();
+		depth--;
+	}
+
+	//a region that ended now after spanning several frames (no GPU time), reported with the current frame
+	void span(const char* name, std::chrono::steady_clock::time_point cpuBegin, std::chrono::steady_clock::time_point cpuEnd) {
+		if (!enabled) return;
+		FrameSlot& slot = slots[current];
+		if (slot.regionCount == MAX_REGIONS) { overflow++; return; }
+		Region& region = slot.regions[slot.regionCount++];
+		region.name = name;
+		region.depth = depth;
+		region.cpuBegin = cpuBegin;
+		region.cpuEnd = cpuEnd;
+		region.cpuOnly = true;
+	}
+
+	//read back every frame still in flight (waits for the GPU: call once at the end)
+	void finish() {
+		for (unsigned int i = 1; i <= FRAME_LATENCY; i++) {
+			FrameSlot& slot = slots[(current + i) % FRAME_LATENCY];
+			if (slot.regionCount) collect(slot, true);
+			slot.regionCount = 0;
+		}
+	}
+
+	const std::vector<Result>& results() const { return finished; }
+
+	//one line per region: frame,region,depth,start_ms,cpu_ms,gpu_ms
+	bool writeCSV(const std::string& path) const {
+		std::ofstream out(path);
+		if (!out) return error(path);
+		out << "frame,region,depth,start_ms,cpu_ms,gpu_ms\n";
+		for (size_t i = 0; i < finished.size(); i++) {
+			const Result& r = finished[i];
+			out << r.frame << ",\"" << r.name << "\"," << r.depth << "," << r.startMs << "," << r.cpuMs << "," << r.gpuMs << "\n";
+		}
+		return (bool)out;
+	}
+
+	//[{"frame": n, "regions": [{"name", "depth", "startMs", "cpuMs", "gpuMs"}, ...]}, ...]
+	bool writeJSON(const std::string& path) const {
+		std::ofstream out(path);
+		if (!out) return error(path);
+		out << "[";
+		for (size_t i = 0; i < finished.size(); i++) {
+			const Result& r = finished[i];
+			bool firstOfFrame = i == 0 || finished[i - 1].frame != r.frame;
+			bool lastOfFrame = i + 1 == finished.size() || finished[i + 1].frame != r.frame;
+			if (firstOfFrame) out << (i ? ",\n" : "\n") << " {\"frame\": " << r.frame << ", \"regions\": [";
+			else out << ", ";
+			out << "{\"name\": \"" << r.name << "\", \"depth\": " << r.depth << ", \"startMs\": " << r.startMs
+				<< ", \"cpuMs\": " << r.cpuMs << ", \"gpuMs\": " << r.gpuMs << "}";
+			if (lastOfFrame) out << "]}";
+		}
+		out << "\n]\n";
+		return (bool)out;
+	}
+
+	//.json -> JSON, anything else -> CSV
+	bool write(const std::string& path) const {
+		bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+		bool written = json ? writeJSON(path) : writeCSV(path);
+		if (written) std::cout << "profile of " << frame << " frames written to " << path << std::endl;
+		return written;
+	}
+
+	//average CPU/GPU time per region name over every frame after frame 0
+	void printSummary() const {
+		std::vector<const char*> names;
+		std::vector<double> cpu, gpu;
+		std::vector<unsigned int> count, gpuCount;
+		for (size_t i = 0; i < finished.size(); i++) {
+			const Result& r = finished[i];
+			if (r.frame == 0) continue;
+			size_t n = 0;
+			while (n < names.size() && names[n] != r.name) n++;
+			if (n == names.size()) {
+				names.push_back(r.name);
+				cpu.push_back(0.0); gpu.push_back(0.0);
+				count.push_back(0); gpuCount.push_back(0);
+			}
+			cpu[n] += r.cpuMs;
+			count[n]++;
+			if (r.gpuMs >= 0.0) { gpu[n] += r.gpuMs; gpuCount[n]++; }
+		}
+		std::cout << "profile (avg per frame, cpu/gpu ms):";
+		for (size_t n = 0; n < names.size(); n++) {
+			std::cout << " " << names[n] << " " << cpu[n] / count[n] << "/";
+			if (gpuCount[n]) std::cout << gpu[n] / gpuCount[n];
+			else std::cout << "-";
+		}
+		std::cout << std::endl;
+		if (dropped || overflow) std::cout << "profile: " << dropped << " GPU results dropped, " << overflow << " regions over the limit" << std::endl;
+	}
+
+
+
+private:
+	struct Region {
+		const char* name;
+		unsigned int depth;
+		std::chrono::steady_clock::time_point cpuBegin, cpuEnd;
+		bool cpuOnly; //added by span(): no queries
+	};
+	struct FrameSlot {
+		unsigned int frame;
+		unsigned int regionCount;
+		Region regions[MAX_REGIONS];
+		GLuint queries[2 * MAX_REGIONS]; //begin/end timestamp per region
+		GLuint lastQuery;                //the query issued last, it finishes last
+	};
+
+	FrameSlot slots[FRAME_LATENCY];
+	unsigned int current, frame, depth;
+	unsigned int dropped, overflow;
+	std::chrono::steady_clock::time_point start;
+	std::vector<Result> finished;
+
+	//(the query objects are never deleted: the profiler lives until exit, after the GL context is gone)
+	Profiler() : enabled(false), current(0), frame(0), depth(0), dropped(0), overflow(0), start(std::chrono::steady_clock::now()) {
+		for (unsigned int i = 0; i < FRAME_LATENCY; i++) {
+			glGenQueries(2 * MAX_REGIONS, slots[i].queries);
+			slots[i].frame = 0;
+			slots[i].regionCount = 0;
+			slots[i].lastQuery = 0;
+		}
+		finished.reserve(4096);
+	}
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	//move a frame's regions to the results. wait=false never blocks: unfinished GPU times are dropped
+	void collect(FrameSlot& slot, bool wait) {
+		GLint available = 1;
+		if (!wait) glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		for (unsigned int i = 0; i < slot.regionCount; i++) {
+			const Region& region = slot.regions[i];
+			Result result;
+			result.frame = slot.frame;
+			result.name = region.name;
+			result.depth = region.depth;
+			result.startMs = std::chrono::duration<double, std::milli>(region.cpuBegin - start).count();
+			result.cpuMs = std::chrono::duration<double, std::milli>(region.cpuEnd - region.cpuBegin).count();
+			result.gpuMs = -1.0;
+			if (!available && !region.cpuOnly) dropped++;
+			if (available && !region.cpuOnly) {
+				GLuint64 gpuBegin = 0, gpuEnd = 0;
+				glGetQueryObjectui64v(slot.queries[2 * i], GL_QUERY_RESULT, &gpuBegin);
+				glGetQueryObjectui64v(slot.queries[2 * i + 1], GL_QUERY_RESULT, &gpuEnd);
+				result.gpuMs = (gpuEnd - gpuBegin) / 1.0e6;
+			}
+			finished.push_back(result);
+		}
+	}
+
+	static bool error(const std::string& path) {
+		std::cout << "(Profiler.h)★ERROR::cannot write " << path << std::endl;
+		return false;
+	}
+};
+
+//profiles the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) : region(Profiler::instance().begin(name)) {}
+	~ProfileScope() { Profiler::instance().end(region); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	unsigned int region;
+};
+#endif // !PROFILER_H
@@ -0,0 +1,143 @@
+/*Asynchronous shader program builds.
+* glCompileShader/glLinkProgram only queue the work, it is the status query right after them that waits.
+* ProgramBuilder submits every program up front (compile + link, no query) and polls them later:
+*   ProgramBuilder builder;
+*   unsigned int a = builder.add(vertexA, fragmentA), b = builder.add(vertexB, fragmentB);
+*   ... load models, start the render loop ...
+*   builder.poll();                        once per frame
+*   if (builder.ready(a)) use builder.program(a)
+* With GL_KHR_parallel_shader_compile (or the ARB version) the driver compiles on its own threads
+* and GL_COMPLETION_STATUS_KHR tells without blocking whether a program is done.
+* Without it there is no way to ask, so poll() finishes one program per call (that one blocks)
+* and the frames in between still run.
+* A program already in the ProgramCache is ready right away.*/
+
+#ifndef PROGRAM_BUILDER_H
+#define PROGRAM_BUILDER_H
+
+#include <glad/glad.h>
+#include "ProgramCache.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+class ProgramBuilder
+{
+public:
+	bool parallel; //the driver compiles in the background (GL_*_parallel_shader_compile)
+
+	ProgramBuilder() : parallel(false), remaining(0) {
+#ifdef GL_KHR_parallel_shader_compile
+		if (GLAD_GL_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu); //as many threads as the driver likes
+			parallel = true;
+		}
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+		if (!parallel && GLAD_GL_ARB_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+			parallel = true;
+		}
+#endif
+	}
+
+	//the programs still building are finished: their owners get working programs even if they never polled
+	~ProgramBuilder() { finish(); }
+	ProgramBuilder(const ProgramBuilder&) = delete;
+	ProgramBuilder& operator=(const ProgramBuilder&) = delete;
+
+	//start building a program. returns its handle for ready()/program()
+	unsigned int add(const char* vertexCode, const char* fragmentCode) {
+		Build build;
+		build.vertexCode = vertexCode;
+		build.fragmentCode = fragmentCode;
+		build.vertexShader = build.fragmentShader = 0;
+		build.done = true;
+		build.program = ProgramCache::instance().load(vertexCode, fragmentCode);
+		if (!build.program) {
+			build.vertexShader = submitShader(GL_VERTEX_SHADER, vertexCode);
+			build.fragmentShader = submitShader(GL_FRAGMENT_SHADER, fragmentCode);
+			build.program = glCreateProgram();
+			glAttachShader(build.program, build.vertexShader);
+			glAttachShader(build.program, build.fragmentShader);
+			ProgramCache::instance().prepare(build.program);
+			glLinkProgram(build.program); //(links once the compiles are done, no need to wait for them here)
+			build.done = false;
+			remaining++;
+		}
+		builds.push_back(build);
+		return (unsigned int)builds.size() - 1;
+	}
+
+	//collect the finished programs without blocking (see above for drivers without the extension).
+	//returns true when every program is done
+	bool poll() {
+		for (unsigned int i = 0; i < builds.size() && remaining; i++) {
+			Build& build = builds[i];
+			if (build.done) continue;
+			if (parallel) {
+				GLint completed = GL_FALSE;
+				glGetProgramiv(build.program, COMPLETION_STATUS, &completed);
+				if (!completed) continue;
+			}
+			complete(build);
+			if (!parallel) break;
+		}
+		return remaining == 0;
+	}
+
+	//wait for every program
+	void finish() {
+		for (unsigned int i = 0; i < builds.size() && remaining; i++) if (!builds[i].done) complete(builds[i]);
+	}
+
+	bool ready(unsigned int handle) const { return builds[handle].done; }
+	//the linked program (the caller owns it). only valid once ready(handle)
+	GLuint program(unsigned int handle) const { return builds[handle].program; }
+	unsigned int pending() const { return remaining; }
+
+private:
+	static const GLenum COMPLETION_STATUS = 0x91B1; //GL_COMPLETION_STATUS_KHR (= _ARB)
+
+	struct Build {
+		std::string vertexCode, fragmentCode; //kept for the cache key
+		GLuint vertexShader, fragmentShader, program;
+		bool done;
+	};
+	std::vector<Build> builds;
+	unsigned int remaining;
+
+	static GLuint submitShader(GLenum type, const char* code) {
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &code, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	//the status queries (blocking if the build isn't done), errors, cache entry, cleanup
+	void complete(Build& build) {
+		GLint success;
+		GLchar infoLog[1024];
+		const GLuint shaders[] = { build.vertexShader, build.fragmentShader };
+		const char* types[] = { "VERTEX", "FRAGMENT" };
+		for (int i = 0; i < 2; i++) {
+			glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+			if (success) continue;
+			glGetShaderInfoLog(shaders[i], 1024, NULL, infoLog);
+			std::cout << "(ProgramBuilder.h)★ERROR::SHADER_COMPILATION::" << types[i] << "\n" << infoLog << std::endl;
+		}
+		glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(build.program, 1024, NULL, infoLog);
+			std::cout << "(ProgramBuilder.h)★ERROR::PROGRAM_LINKING\n" << infoLog << std::endl;
+		}
+		else ProgramCache::instance().save(build.program, build.vertexCode.c_str(), build.fragmentCode.c_str());
+
+		glDeleteShader(build.vertexShader);
+		glDeleteShader(build.fragmentShader);
+		build.vertexShader = build.fragmentShader = 0;
+		build.done = true;
+		remaining--;
+	}
+};
+#endif // !PROGRAM_BUILDER_H
@@ -0,0 +1,176 @@
+/*Disk cache of linked shader programs (glGetProgramBinary / glProgramBinary, GL 4.1).
+* Compiling + linking GLSL costs milliseconds per program on every launch, the driver's binary loads in a fraction of that.
+*   ID = ProgramCache::instance().load(vertexCode, fragmentCode);      0: not cached -> compile as usual, and
+*   ProgramCache::instance().link(ID, vertexCode, fragmentCode);       instead of glLinkProgram(ID) (stores the binary)
+* An entry is keyed by a hash of both sources plus GL_VENDOR/GL_RENDERER/GL_VERSION:
+* a new driver or GPU looks for other files and never gets a binary of the old one.
+* The driver can still refuse a binary (glProgramBinary leaves the program unlinked), then the entry is deleted
+* and the caller compiles, which writes a fresh one. Corrupt or truncated files fail the header/checksum test the same way.*/
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+
+class ProgramCache
+{
+public:
+	bool enabled;           //off (or no binary format in the driver): load() always misses, link() only links
+	std::string directory;  //where the entries go, created on the first store
+	unsigned int hits, misses, rejected; //load() results so far (rejected: a file the driver or the checks refused)
+
+	//one cache per process (create it after the GL context)
+	static ProgramCache& instance() {
+		static ProgramCache cache;
+		return cache;
+	}
+
+	//a program linked from the cached binary of these sources, 0 if there is none
+	GLuint load(const char* vertexCode, const char* fragmentCode) {
+		if (!enabled) return 0;
+		std::string path = entryPath(key(vertexCode, fragmentCode));
+		std::ifstream in(path, std::ios::binary);
+		if (!in) { misses++; return 0; }
+
+		Header header;
+		std::vector<char> binary;
+		bool valid = (bool)in.read((char*)&header, sizeof(header)) && memcmp(header.magic, MAGIC, 4) == 0 && header.version == VERSION
+			&& header.key == key(vertexCode, fragmentCode) && header.length > 0;
+		if (valid) {
+			binary.resize(header.length);
+			valid = (bool)in.read(&binary[0], header.length) && hash(binary.data(), binary.size(), FNV_OFFSET) == header.checksum;
+		}
+		in.close();
+
+		GLuint program = 0;
+		if (valid) {
+			program = glCreateProgram();
+			glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+			GLint linked = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &linked);
+			if (!linked) {
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+		if (!program) {
+			rejected++;
+			std::error_code error;
+			std::filesystem::remove(path, error);
+			return 0;
+		}
+		hits++;
+		return program;
+	}
+
+	//link a program whose shaders are attached, and store its binary for the next launch
+	void link(GLuint program, const char* vertexCode, const char* fragmentCode) {
+		prepare(program);
+		glLinkProgram(program);
+		save(program, vertexCode, fragmentCode);
+	}
+
+	//the two halves of link() for a caller that links itself (ProgramBuilder: the link finishes in the background)
+	//prepare() before glLinkProgram, save() once the link is done (waits for it)
+	void prepare(GLuint program) {
+		if (enabled) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	void save(GLuint program, const char* vertexCode, const char* fragmentCode) {
+		if (!enabled) return;
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked) store(program, key(vertexCode, fragmentCode));
+	}
+
+	//delete every entry (the next launch compiles everything again)
+	void clear() {
+		std::error_code error;
+		std::filesystem::remove_all(directory, error);
+	}
+
+private:
+	static const uint32_t VERSION = 1;
+	static constexpr char MAGIC[4] = { 'X', 'P', 'R', 'G' };
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t key;       //the entry's key again (file name collisions, renamed files)
+		uint32_t format;    //binaryFormat of glGetProgramBinary
+		uint32_t length;
+		uint64_t checksum;  //of the binary
+	};
+
+	uint64_t driver; //hash of the vendor/renderer/version strings, the start of every key
+
+	ProgramCache() : enabled(true), directory("shader_cache"), hits(0), misses(0), rejected(0), driver(FNV_OFFSET) {
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats == 0) enabled = false; //(the driver can't give binaries back)
+		const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (int i = 0; i < 3; i++) {
+			const char* value = (const char*)glGetString(names[i]);
+			if (value) driver = hash(value, strlen(value) + 1, driver);
+		}
+	}
+	ProgramCache(const ProgramCache&) = delete;
+	ProgramCache& operator=(const ProgramCache&) = delete;
+
+	//FNV-1a, continued from seed
+	static uint64_t hash(const void* data, size_t size, uint64_t seed) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) seed = (seed ^ bytes[i]) * 1099511628211ull;
+		return seed;
+	}
+
+	uint64_t key(const char* vertexCode, const char* fragmentCode) const {
+		uint64_t value = hash(vertexCode, strlen(vertexCode) + 1, driver);
+		return hash(fragmentCode, strlen(fragmentCode) + 1, value);
+	}
+
+	std::string entryPath(uint64_t entry) const {
+		char name[24];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)entry);
+		return directory + "/" + name;
+	}
+
+	void store(GLuint program, uint64_t entry) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+		std::vector<char> binary(length);
+		Header header;
+		memset(&header, 0, sizeof(header));
+		GLenum format = 0;
+		glGetProgramBinary(program, length, NULL, &format, binary.data());
+		memcpy(header.magic, MAGIC, 4);
+		header.version = VERSION;
+		header.key = entry;
+		header.format = format;
+		header.length = (uint32_t)length;
+		header.checksum = hash(binary.data(), binary.size(), FNV_OFFSET);
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		//write next to the entry and rename, so a crash never leaves half a file under the entry's name
+		std::string path = entryPath(entry), temporary = path + ".tmp";
+		{
+			std::ofstream out(temporary, std::ios::binary);
+			if (!out.write((const char*)&header, sizeof(header)) || !out.write(binary.data(), binary.size())) {
+				std::cout << "(ProgramCache.h)★ERROR::cannot write " << temporary << std::endl;
+				return;
+			}
+		}
+		std::filesystem::rename(temporary, path, error);
+	}
+};
+#endif // !PROGRAM_CACHE_H
@@ -0,0 +1,262 @@
+/*Window or headless GL context for the demos.
+* The demos create a 1600x1200 GLFW window and swap its buffers, so they can't run on a build machine without a display/GPU.
+* RenderContext does the context setup + frame pacing for both cases:
+*   windowed (default): a GLFW window, endFrame() swaps buffers and polls events.
+*   headless (--headless): a surfaceless EGL context (Mesa llvmpipe works without a GPU),
+*     the frames are rendered into an FBO, endFrame() waits for the GPU and records the frame time.
+*     After the last frame the timings are printed and the image can be written as a PPM (--capture).
+*     The scene time advances by a fixed 1/60 s per frame, so captures are reproducible.
+* command line: <demo> [--headless] [--frames N] [--capture file.ppm] [--profile file.csv|file.json]
+*   (--frames also ends a windowed run after N frames, --profile is for the demo's Profiler, see Profiler.h)
+* without EGL headers (e.g. Windows) --headless falls back to a hidden GLFW window, still rendering into the FBO.*/
+
+#ifndef RENDER_CONTEXT_H
+#define RENDER_CONTEXT_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#if defined(__has_include)
+#if __has_include(<EGL/egl.h>)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define RENDER_CONTEXT_EGL
+#endif
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+//command line options of a demo
+struct RenderOptions {
+	bool headless;
+	int frames;          //frames to render, 0 = until the window is closed (headless default: 100)
+	std::string capture; //PPM file for the last frame (headless only)
+	std::string profile; //Profiler output, empty = don't profile
+};
+
+RenderOptions parseRenderOptions(int argc, char** argv) {
+	RenderOptions options;
+	options.headless = false;
+	options.frames = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) options.headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) options.frames = std::atoi(argv[++i]);
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) options.capture = argv[++i];
+		else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) options.profile = argv[++i];
+	}
+	if (options.headless && options.frames <= 0) options.frames = 100;
+	return options;
+}
+
+
+
+class RenderContext
+{
+public:
+	GLFWwindow* window; //NULL when headless: skip input and window callbacks
+	unsigned int width, height;
+
+	//creates the context and loads the GL functions (check ok() before doing anything else)
+	RenderContext(const RenderOptions& renderOptions, unsigned int w, unsigned int h, const char* title)
+		: window(NULL), width(w), height(h), options(renderOptions), frame(0), valid(false), glfwStarted(false),
+		framebuffer(0), colorBuffer(0), depthBuffer(0) {
+#ifdef RENDER_CONTEXT_EGL
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+		if (options.headless) {
+			if (!createSurfaceless()) return;
+			valid = setupHeadless();
+			return;
+		}
+#endif
+		glfwInit();
+		glfwStarted = true;
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		if (options.headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		window = glfwCreateWindow(width, height, title, NULL, NULL);
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			return;
+		}
+		glfwMakeContextCurrent(window);
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return;
+		}
+		if (options.headless) {
+			std::cout << "(RenderContext.h) no EGL in this build, headless run uses a hidden window" << std::endl;
+			valid = setupHeadless();
+			window = NULL; //the demo must not poll/handle input
+			return;
+		}
+		valid = true;
+	}
+
+	~RenderContext() {
+		if (options.headless && valid) report();
+		if (framebuffer) {
+			glDeleteFramebuffers(1, &framebuffer);
+			glDeleteRenderbuffers(1, &colorBuffer);
+			glDeleteRenderbuffers(1, &depthBuffer);
+		}
+#ifdef RENDER_CONTEXT_EGL
+		if (context != EGL_NO_CONTEXT) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(display, context);
+		}
+		if (display != EGL_NO_DISPLAY) eglTerminate(display);
+#endif
+		if (glfwStarted) glfwTerminate();
+	}
+
+	RenderContext(const RenderContext&) = delete;
+	RenderContext& operator=(const RenderContext&) = delete;
+
+	bool ok() const { return valid; }
+	bool headless() const { return options.headless; }
+
+	//render loop condition
+	bool running() const {
+		if (options.frames > 0 && frame >= (unsigned int)options.frames) return false;
+		if (window) return !glfwWindowShouldClose(window);
+		return true;
+	}
+
+	//scene time in seconds (replaces glfwGetTime in the demos)
+	double time() const {
+		if (options.headless) return frame / 60.0;
+		return glfwGetTime();
+	}
+
+	//end of a frame: present it (windowed) or finish + time it (headless)
+	void endFrame() {
+		if (options.headless) {
+			glFinish(); //frame time includes the GPU work
+			auto now = std::chrono::steady_clock::now();
+			frameTimes.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+			frameStart = now;
+			if (frame + 1 == (unsigned int)options.frames && !options.capture.empty()) capture(options.capture);
+		}
+		else {
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		frame++;
+	}
+
+	//read the current frame back and write it as a binary PPM (top row first)
+	bool capture(const std::string& path) const {
+		std::vector<unsigned char> pixels((size_t)width * height * 3);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+		std::ofstream out(path, std::ios::binary);
+		if (!out) {
+			std::cout << "(RenderContext.h)★ERROR::cannot write " << path << std::endl;
+			return false;
+		}
+		out << "P6\n" << width << " " << height << "\n255\n";
+		for (unsigned int row = height; row-- > 0;) out.write((const char*)&pixels[(size_t)row * width * 3], (std::streamsize)width * 3);
+		std::cout << "captured frame " << frame << " into " << path << std::endl;
+		return (bool)out;
+	}
+
+
+
+private:
+	RenderOptions options;
+	unsigned int frame;
+	bool valid, glfwStarted;
+	unsigned int framebuffer, colorBuffer, depthBuffer;
+	std::vector<double> frameTimes; //ms per headless frame
+	std::chrono::steady_clock::time_point frameStart;
+#ifdef RENDER_CONTEXT_EGL
+	EGLDisplay display;
+	EGLContext context;
+
+	//EGL context without any surface: Mesa's surfaceless platform needs neither X11/Wayland nor a GPU
+	bool createSurfaceless() {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			std::cout << "(RenderContext.h)★ERROR::EGL::no display" << std::endl;
+			return false;
+		}
+		eglBindAPI(EGL_OPENGL_API);
+
+		//(the default EGL_SURFACE_TYPE is EGL_WINDOW_BIT, which a surfaceless display has none of)
+		const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+			std::cout << "(RenderContext.h)★ERROR::EGL::no OpenGL config" << std::endl;
+			return false;
+		}
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+			std::cout << "(RenderContext.h)★ERROR::EGL::cannot create a surfaceless OpenGL 3.3 core context" << std::endl;
+			return false;
+		}
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return false;
+		}
+		std::cout << "headless: EGL " << major << "." << minor << ", " << glGetString(GL_RENDERER) << std::endl;
+		return true;
+	}
+#endif
+
+	//the FBO every headless frame is rendered into (stays bound: the demos draw to framebuffer "0" of their view)
+	bool setupHeadless() {
+		glGenRenderbuffers(1, &colorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glGenRenderbuffers(1, &depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "(RenderContext.h)★ERROR::offscreen framebuffer is not complete" << std::endl;
+			return false;
+		}
+		glViewport(0, 0, width, height);
+		frameTimes.reserve(options.frames);
+		frameStart = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	//frame time summary of a headless run (the first frame includes shader/texture warm-up, it is reported separately)
+	void report() const {
+		if (frameTimes.empty()) return;
+		std::vector<double> sorted(frameTimes.begin() + (frameTimes.size() > 1 ? 1 : 0), frameTimes.end());
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (size_t i = 0; i < sorted.size(); i++) total += sorted[i];
+		double average = total / sorted.size();
+		std::cout << "headless: " << frameTimes.size() << " frames " << width << "x" << height
+			<< ", first " << frameTimes[0] << " ms, then avg " << average << " ms (min " << sorted.front()
+			<< ", median " << sorted[sorted.size() / 2] << ", max " << sorted.back() << "), " << 1000.0 / average << " fps" << std::endl;
+	}
+};
+#endif // !RENDER_CONTEXT_H
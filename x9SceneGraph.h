@@ -0,0 +1,115 @@
+/*Transform hierarchy as a flat node array.
+* Every node stores its parent index, its local matrix (relative to the parent) and its world matrix (local * all parents).
+* Parents always come before their children in the array, so one forward sweep updates the whole hierarchy:
+* by the time a node is reached its parent's world matrix is already up to date.
+* setLocal() only marks the node dirty, update() recomputes the dirty nodes and everything below them and leaves the rest alone
+* (the sweep starts at the first dirty node, a clean node whose parent didn't change costs one flag test).
+* The matrix product uses SSE where available: a column of the result is the 4 columns of the parent scaled by the child's column.*/
+
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_GRAPH_SSE
+#endif
+
+//out = a * b for column major 4x4 matrices (out must not alias a or b)
+inline void multiplyMatrices(const float* a, const float* b, float* out) {
+#ifdef SCENE_GRAPH_SSE
+	__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+	for (int column = 0; column < 4; column++) {
+		const float* c = b + 4 * column;
+		__m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(c[0])), _mm_mul_ps(a1, _mm_set1_ps(c[1]))),
+			_mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(c[2])), _mm_mul_ps(a3, _mm_set1_ps(c[3]))));
+		_mm_storeu_ps(out + 4 * column, result);
+	}
+#else
+	for (int column = 0; column < 4; column++)
+		for (int row = 0; row < 4; row++)
+			out[4 * column + row] = a[row] * b[4 * column] + a[4 + row] * b[4 * column + 1] + a[8 + row] * b[4 * column + 2] + a[12 + row] * b[4 * column + 3];
+#endif
+}
+
+class SceneGraph
+{
+public:
+	enum : unsigned int { NO_PARENT = 0xFFFFFFFFu }; //(an enumerator: needs no out-of-class definition when used by reference)
+
+	//one entry per node, in parent-before-child order
+	std::vector<unsigned int> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<std::string> names;
+
+	SceneGraph() : firstDirty(NO_PARENT) {}
+
+	//append a node (the parent must already exist). returns its index
+	unsigned int addNode(unsigned int parent, const glm::mat4& local, const std::string& name = "") {
+		unsigned int index = (unsigned int)parents.size();
+		parents.push_back(parent < index ? parent : NO_PARENT);
+		locals.push_back(local);
+		worlds.push_back(local);
+		names.push_back(name);
+		dirty.push_back(1);
+		if (firstDirty == NO_PARENT) firstDirty = index;
+		return index;
+	}
+
+	size_t size() const { return parents.size(); }
+	void reserve(size_t count) {
+		parents.reserve(count); locals.reserve(count); worlds.reserve(count); names.reserve(count); dirty.reserve(count);
+	}
+	void clear() {
+		parents.clear(); locals.clear(); worlds.clear(); names.clear(); dirty.clear();
+		firstDirty = NO_PARENT;
+	}
+
+	//change a node's transform, its subtree is recomputed by the next update()
+	void setLocal(unsigned int node, const glm::mat4& local) {
+		locals[node] = local;
+		dirty[node] = 1;
+		if (firstDirty == NO_PARENT || node < firstDirty) firstDirty = node;
+	}
+
+	//true if node is ancestor or one of its descendants
+	bool inSubtree(unsigned int node, unsigned int ancestor) const {
+		for (; node != NO_PARENT; node = parents[node]) if (node == ancestor) return true;
+		return false;
+	}
+
+	//first node with the given name, NO_PARENT if there is none
+	unsigned int find(const std::string& name) const {
+		for (unsigned int i = 0; i < names.size(); i++) if (names[i] == name) return i;
+		return NO_PARENT;
+	}
+
+	//recompute the world matrices of the dirty nodes and their subtrees. returns the number of nodes recomputed
+	size_t update() {
+		if (firstDirty == NO_PARENT) return 0;
+		size_t updated = 0;
+		size_t count = parents.size();
+		for (size_t i = firstDirty; i < count; i++) {
+			unsigned int parent = parents[i];
+			//a node changes with its parent: pass the flag down (cleared below, after the sweep)
+			if (!dirty[i] && (parent == NO_PARENT || !dirty[parent])) continue;
+			dirty[i] = 1;
+			if (parent == NO_PARENT) worlds[i] = locals[i];
+			else multiplyMatrices(&worlds[parent][0][0], &locals[i][0][0], &worlds[i][0][0]);
+			updated++;
+		}
+		memset(&dirty[firstDirty], 0, count - firstDirty);
+		firstDirty = NO_PARENT;
+		return updated;
+	}
+
+private:
+	std::vector<unsigned char> dirty; //set by setLocal()/addNode(), inherited by the subtree during update()
+	unsigned int firstDirty;          //lowest dirty index: the sweep starts here (NO_PARENT: nothing to do)
+};
+#endif // !SCENE_GRAPH_H
@@ -2,7 +2,16 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include "UniformTable.h"
+#include "ProgramCache.h"
+#include "ProgramBuilder.h"
+#include "FileWatcher.h"
+#include "GLState.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,94 +19,252 @@
 class Shader 
 {
 public:
-	unsigned int ID;
+	unsigned int ID;       //0 while a background build is still running (see ready())
+	UniformTable uniforms; //name -> location of the active uniforms
+	//a new number for every program ID gets, never reused (unlike GL program names):
+	//caches of per-program data (uniform locations, ...) are keyed on it. 0 while not built
+	unsigned int generation;
 
-	Shader() {
-		const char* vertexShaderCode = "#version 410 core\n"
+	Shader() : generation(0), builder(nullptr), build(0) {
+		ID = buildProgram(vertexCode(), fragmentCode());
+		programLinked(); //reflect the active uniforms once, the setters look them up here
+	}
+
+	//sources from GLSL files. watch: reload() picks up edits of the files while the program runs
+	Shader(const std::string& vertexPath, const std::string& fragmentPath, bool watch = true)
+		: generation(0), builder(nullptr), build(0), vertexPath(vertexPath), fragmentPath(fragmentPath) {
+		std::string vertexShaderCode = readFile(vertexPath), fragmentShaderCode = readFile(fragmentPath);
+		ID = buildProgram(vertexShaderCode.c_str(), fragmentShaderCode.c_str());
+		programLinked();
+		if (watch) {
+			watcher.reset(new FileWatcher());
+			watcher->watch(vertexPath);
+			watcher->watch(fragmentPath);
+		}
+	}
+
+	//build in the background: returns right away, the shader can be used once ready() says so.
+	//(the builder must live until then)
+	Shader(ProgramBuilder& programBuilder) : ID(0), generation(0), builder(&programBuilder) {
+		build = builder->add(vertexCode(), fragmentCode());
+		ready();
+	}
+
+	//file shader: if a source file changed, build the new version and swap it in (call once per frame, between draws).
+	//a version that doesn't compile or link is reported and dropped, the old program stays.
+	//returns true if ID is a new program: it starts with every uniform at 0, set the ones that were set once again
+	bool reload() {
+		if (!watcher || !watcher->changed()) return false;
+		std::string vertexShaderCode = readFile(vertexPath), fragmentShaderCode = readFile(fragmentPath);
+		if (vertexShaderCode.empty() || fragmentShaderCode.empty()) return false; //(caught in the middle of a save)
+		GLuint program = buildProgram(vertexShaderCode.c_str(), fragmentShaderCode.c_str());
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			std::cout << "(Shader.h)★ERROR::SHADER::" << vertexPath << " + " << fragmentPath << " failed to build, keeping the running version" << std::endl;
+			glDeleteProgram(program);
+			return false;
+		}
+		GLState::instance().programDeleted(ID);
+		glDeleteProgram(ID);
+		ID = program;
+		programLinked();
+		std::cout << "reloaded " << vertexPath << " + " << fragmentPath << std::endl;
+		return true;
+	}
+
+	//true once the program is linked (always for the blocking constructor). call ProgramBuilder::poll() to make progress
+	bool ready() {
+		if (ID) return true;
+		if (!builder->ready(build)) return false;
+		ID = builder->program(build);
+		programLinked();
+		return true;
+	}
+
+	static const char* vertexCode() {
+		return "#version 410 core\n"
 			"layout (location = 0) in vec3 aPos;"
 			"layout (location = 1) in vec3 aNormal;"
 			"layout (location = 2) in vec2 aTexCoords;"
+			"layout (location = 3) in mat4 aInstanceModel;" //per-instance model matrix (InstanceBuffer.h)
 			"out vec2 TexCoords;"
 			"uniform mat4 model;"
 			"uniform mat4 view;"
 			"uniform mat4 projection;"
+			"uniform bool instanced;" //true: the model matrix comes from aInstanceModel (one glDraw*Instanced for many objects)
 			"void main() {"
-			"	gl_Position = projection * view * model * vec4(aPos, 1.0);"
+			"	gl_Position = projection * view * (instanced ? aInstanceModel : model) * vec4(aPos, 1.0);"
 			" 	TexCoords = aTexCoords;}\0";
-		const char* fragmentShaderCode = "#version 410 core\n"
+	}
+	static const char* fragmentCode() {
+		return "#version 410 core\n"
 			"out vec4 FragColor;"
 			"in vec2 TexCoords;"
 			"uniform sampler2D texture_diffuse1;"
 			"void main() {"
 			"	FragColor = texture(texture_diffuse1, TexCoords);}\0";
-
-		unsigned int vertexShader, fragmentShader;
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
-		glCompileShader(vertexShader);
-		checkCompileError(vertexShader, "VERTEX");
-
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		checkCompileError(fragmentShader, "FRAGMENT");
-
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
 	}
 
-	//activate shaders
-	void use() { glUseProgram(ID); }
+	//activate shaders (skipped if the program is already in use)
+	void use() { GLState::instance().useProgram(ID); }
 
 	//utility uniform function
 	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(uniforms.find(name), (int)value);
 	}
 	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(uniforms.find(name), value);
 	}
 	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(uniforms.find(name), value);
 	}
 
 	void setVec2(const std::string& name, const glm::vec2& value) const {
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform2fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec2(const std::string& name, float x, float y) const {
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2f(uniforms.find(name), x, y);
 	}
 	void setVec3(const std::string& name, const glm::vec3& value) const {
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec3(const std::string& name, float x, float y, float z) const {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(uniforms.find(name), x, y, z);
 	}
 	void setVec4(const std::string& name, const glm::vec4& value) const{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform4fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec4(const std::string& name , float x, float y, float z, float w) {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(uniforms.find(name), x, y, z, w);
 	}
 
 	void setMat2(const std::string& name, const glm::mat2& mat) const {
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	void setMat3(const std::string& name, const glm::mat3& mat) const{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	void setMat4(const std::string& name, const glm::mat4& mat) const{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
 	}
 
+	//resolve a uniform once (e.g. before a render loop) and pass the handle to the setters below
+	UniformHandle uniform(const std::string& name) const {
+		UniformHandle handle;
+		handle.location = uniforms.find(name);
+		return handle;
+	}
+	//connect the program's uniform block to a binding point (see UniformBlock.h). a block the program doesn't use is skipped.
+	//(program state like the uniforms: again after reload())
+	void bindBlock(const char* blockName, GLuint binding) const {
+		GLuint index = glGetUniformBlockIndex(ID, blockName);
+		if (index != GL_INVALID_INDEX) glUniformBlockBinding(ID, index, binding);
+	}
+	//the texture unit of a sampler uniform ("texture_diffuse1", ...), -1 if the program doesn't use it.
+	//the first call for a name gives it the next free unit and sets the sampler, so the sampler is set once per program
+	//and means the same unit for every mesh drawn with it (makes the program current)
+	int samplerUnit(const std::string& name) {
+		for (unsigned int i = 0; i < samplerNames.size(); i++)
+			if (samplerNames[i] == name) return (int)i;
+		GLint location = uniforms.find(name);
+		if (location < 0) return -1;
+		samplerNames.push_back(name);
+		use();
+		glUniform1i(location, (int)samplerNames.size() - 1);
+		return (int)samplerNames.size() - 1;
+	}
 
-
+	void setBool(UniformHandle uniform, bool value) const {
+		glUniform1i(uniform.location, (int)value);
+	}
+	void setInt(UniformHandle uniform, int value) const {
+		glUniform1i(uniform.location, value);
+	}
+	void setFloat(UniformHandle uniform, float value) const {
+		glUniform1f(uniform.location, value);
+	}
+	void setVec2(UniformHandle uniform, const glm::vec2& value) const {
+		glUniform2fv(uniform.location, 1, &value[0]);
+	}
+	void setVec2(UniformHandle uniform, float x, float y) const {
+		glUniform2f(uniform.location, x, y);
+	}
+	void setVec3(UniformHandle uniform, const glm::vec3& value) const {
+		glUniform3fv(uniform.location, 1, &value[0]);
+	}
+	void setVec3(UniformHandle uniform, float x, float y, float z) const {
+		glUniform3f(uniform.location, x, y, z);
+	}
+	void setVec4(UniformHandle uniform, const glm::vec4& value) const {
+		glUniform4fv(uniform.location, 1, &value[0]);
+	}
+	void setVec4(UniformHandle uniform, float x, float y, float z, float w) {
+		glUniform4f(uniform.location, x, y, z, w);
+	}
+	void setMat2(UniformHandle uniform, const glm::mat2& mat) const {
+		glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat3(UniformHandle uniform, const glm::mat3& mat) const {
+		glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat4(UniformHandle uniform, const glm::mat4& mat) const {
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
 
 
 private:
+	//ID is a new program: its uniforms, its generation
+	void programLinked() {
+		static unsigned int generations = 0;
+		uniforms.build(ID);
+		generation = ++generations;
+		samplerNames.clear(); //(a new program starts with every sampler at unit 0)
+	}
+
+	std::vector<std::string> samplerNames; //samplerNames[unit] = the sampler set to that unit, see samplerUnit()
+
+	ProgramBuilder* builder; //the background build of ID (nullptr: built by the blocking constructor)
+	unsigned int build;
+	std::string vertexPath, fragmentPath; //sources of a file shader
+	std::unique_ptr<FileWatcher> watcher;  //their changes (nullptr: not watched)
+
+	//compile + link (or load the cached binary of the same sources, see ProgramCache.h)
+	GLuint buildProgram(const char* vertexShaderCode, const char* fragmentShaderCode) {
+		GLuint program = ProgramCache::instance().load(vertexShaderCode, fragmentShaderCode);
+		if (program) return program;
+
+		unsigned int vertexShader, fragmentShader;
+		vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+		glCompileShader(vertexShader);
+		checkCompileError(vertexShader, "VERTEX");
+
+		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+		glCompileShader(fragmentShader);
+		checkCompileError(fragmentShader, "FRAGMENT");
+
+		program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		ProgramCache::instance().link(program, vertexShaderCode, fragmentShaderCode); //links, and keeps the binary for the next launch
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return program;
+	}
+
+	static std::string readFile(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) {
+			std::cout << "(Shader.h)★ERROR::SHADER::cannot read " << path << std::endl;
+			return std::string();
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		return stream.str();
+	}
+
 	void checkCompileError(GLuint shader, std::string type) {
 		GLint success;
 		GLchar infoLog[1024];
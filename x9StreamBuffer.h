@@ -0,0 +1,163 @@
+/*Streaming buffer for the data that changes every frame (per-object matrices, uniform blocks, instance arrays).
+* One buffer, mapped once for its whole life (GL 4.4 / ARB_buffer_storage: GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT),
+* split into FRAME_COUNT regions. A frame writes its data linearly into its region and binds it by offset:
+*   StreamBuffer stream(64 * 1024);               bytes per frame (fixed: the buffer is never reallocated), rounded up so every
+*                                                  region starts at a multiple of the uniform buffer offset alignment
+*   stream.beginFrame();                           takes the next region (waits only if the GPU still reads it)
+*   GLintptr offset;
+*   ObjectBlock* object = stream.allocate<ObjectBlock>(offset, alignment);
+*   object->model = ...;
+*   stream.flush();                                 (no-op when mapped persistently)
+*   stream.bindRange(GL_UNIFORM_BUFFER, binding, offset, sizeof(ObjectBlock));   draw
+*   stream.endFrame();                              fences the region: the draws of this frame read it
+* With three regions the CPU writes frame n while the GPU may still draw n-1 and n-2: a wait means the GPU is more than
+* two frames behind, the counters below say how often that happened and how long it took.
+* A region that is full returns nullptr (counted in overflows) instead of growing: size the buffer for the worst frame.
+* Without buffer storage the region is staged in memory and flush() sends what was written since the last flush
+* with glBufferSubData (call it before the draws that read the data).*/
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+class StreamBuffer
+{
+public:
+	static const unsigned int FRAME_COUNT = 3;
+
+	GLuint buffer;
+	size_t frameSize;    //bytes of one region (a multiple of the region alignment, see the constructor)
+	bool persistent;     //mapped persistently, false: glBufferSubData on flush()
+	//counters (since construction)
+	size_t frames;       //beginFrame() calls
+	size_t fenceWaits;   //beginFrame() found its region still in use by the GPU and had to wait
+	double fenceWaitMs;  //time spent in those waits
+	size_t overflows;    //allocate() calls that didn't fit in the region
+	size_t peakUsed;     //most bytes a frame has used
+
+	//maxAlignment: the largest alignment the allocations ask for, 0: GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	//frameSize is rounded up to it, so region n starts aligned and an offset aligned inside a region is aligned in the buffer
+	StreamBuffer(size_t bytesPerFrame, GLenum bufferTarget = GL_UNIFORM_BUFFER, size_t maxAlignment = 0)
+		: buffer(0), frameSize(bytesPerFrame), persistent(false), frames(0), fenceWaits(0), fenceWaitMs(0.0), overflows(0), peakUsed(0),
+		target(bufferTarget), mapped(nullptr), region(FRAME_COUNT - 1), used(0), flushed(0) {
+		for (unsigned int i = 0; i < FRAME_COUNT; i++) fences[i] = 0;
+		if (maxAlignment == 0) {
+			GLint offsetAlignment = 0;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+			maxAlignment = offsetAlignment > 16 ? (size_t)offsetAlignment : 16; //(16: a vec4/mat4 stays aligned for the other targets)
+		}
+		frameSize = (frameSize + maxAlignment - 1) / maxAlignment * maxAlignment;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+		bool storage = false;
+#ifdef GL_VERSION_4_4
+		storage = GLAD_GL_VERSION_4_4;
+#endif
+#ifdef GL_ARB_buffer_storage
+		storage = storage || GLAD_GL_ARB_buffer_storage;
+#endif
+		if (storage) {
+			//coherent: the writes are visible to the GPU without an explicit flush
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(target, FRAME_COUNT * frameSize, NULL, flags);
+			mapped = (unsigned char*)glMapBufferRange(target, 0, FRAME_COUNT * frameSize, flags);
+			persistent = mapped != nullptr;
+			if (!persistent) {
+				//immutable storage without GL_DYNAMIC_STORAGE_BIT takes no glBufferSubData either: start over
+				glDeleteBuffers(1, &buffer);
+				glGenBuffers(1, &buffer);
+				glBindBuffer(target, buffer);
+			}
+		}
+#endif
+		if (!persistent) {
+			glBufferData(target, FRAME_COUNT * frameSize, NULL, GL_DYNAMIC_DRAW);
+			staging.resize(frameSize);
+		}
+	}
+	~StreamBuffer() {
+		for (unsigned int i = 0; i < FRAME_COUNT; i++) if (fences[i]) glDeleteSync(fences[i]);
+		if (mapped) {
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+		}
+		glDeleteBuffers(1, &buffer);
+	}
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	//move on to the next region
+	void beginFrame() {
+		region = (region + 1) % FRAME_COUNT;
+		used = flushed = 0;
+		frames++;
+		if (!fences[region]) return;
+		//the GPU is done with it unless it is FRAME_COUNT - 1 frames behind: check without waiting first
+		GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			auto start = std::chrono::steady_clock::now();
+			glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+			fenceWaits++;
+			fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	//the draws submitted since beginFrame() read this region: fence it
+	void endFrame() {
+		if (fences[region]) glDeleteSync(fences[region]);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	//size bytes in this frame's region, at a multiple of alignment in the buffer (uniform blocks: GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT).
+	//offset: where they are in the buffer, for bindRange()/attribute pointers. nullptr if the region is full
+	void* allocate(size_t size, size_t alignment, GLintptr& offset) {
+		//(aligned as a buffer offset, not only inside the region: holds for an alignment above the constructor's too)
+		size_t base = region * frameSize;
+		size_t start = alignment > 1 ? (base + used + alignment - 1) / alignment * alignment - base : used;
+		if (start + size > frameSize) {
+			overflows++;
+			return nullptr;
+		}
+		used = start + size;
+		if (used > peakUsed) peakUsed = used;
+		offset = (GLintptr)(region * frameSize + start);
+		return persistent ? mapped + offset : &staging[start];
+	}
+	template <typename T>
+	T* allocate(GLintptr& offset, size_t alignment = alignof(T)) { return (T*)allocate(sizeof(T), alignment, offset); }
+
+	//send what was written since the last flush (nothing to do when mapped persistently + coherent)
+	void flush() {
+		if (persistent || flushed == used) return;
+		glBindBuffer(target, buffer);
+		glBufferSubData(target, (GLintptr)(region * frameSize + flushed), (GLsizeiptr)(used - flushed), &staging[flushed]);
+		flushed = used;
+	}
+
+	//bind an allocation to an indexed binding point (GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER ...)
+	void bindRange(GLenum bindTarget, GLuint index, GLintptr offset, GLsizeiptr size) const {
+		glBindBufferRange(bindTarget, index, buffer, offset, size);
+	}
+
+	void printStats() const {
+		std::cout << "stream buffer: " << (persistent ? "persistent" : "glBufferSubData") << ", " << frameSize / 1024 << " KB x " << FRAME_COUNT
+			<< ", peak " << peakUsed << " bytes/frame, " << fenceWaits << " fence waits in " << frames << " frames (" << fenceWaitMs << " ms), "
+			<< overflows << " overflows" << std::endl;
+	}
+
+private:
+	GLenum target;                  //what the buffer is bound to while creating/flushing it
+	unsigned char* mapped;          //persistent mapping of all the regions
+	std::vector<unsigned char> staging; //the current region when not mapped
+	unsigned int region;            //current region
+	size_t used, flushed;           //bytes allocated in it, and sent by flush()
+	GLsync fences[FRAME_COUNT];     //signaled once the GPU is done with region i
+};
+#endif // !STREAM_BUFFER_H
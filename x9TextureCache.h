@@ -0,0 +1,156 @@
+/*Process-wide texture cache.
+* A texture file is decoded and uploaded once per process, every further request for it returns the same texture object.
+* Entries are keyed by the canonical absolute path plus the load flags (gamma, normal map, vertical flip),
+* so "a/../tex.png" and "tex.png" hit the same entry but an sRGB and a linear load of the same file don't
+* (nor a normal map, whose mips are renormalized, and a color texture of the same file).
+* Each load() adds a reference, release() drops one and the texture is deleted with the last reference.*/
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+using namespace std;
+
+class TextureCache
+{
+public:
+	//hit/miss statistics
+	struct Stats {
+		size_t hits;     //requests answered from the cache
+		size_t misses;   //requests that had to decode + upload
+		size_t resident; //textures currently in the cache
+	};
+
+	//the one cache of the process
+	static TextureCache& instance() {
+		static TextureCache cache;
+		return cache;
+	}
+
+	//set stb_image's vertical flip (use this instead of stbi_set_flip_vertically_on_load so the flag is part of the key)
+	void setFlipVertically(bool flip) {
+		flipVertically = flip;
+		stbi_set_flip_vertically_on_load(flip);
+		textureLoadOptions().flipVertically = flip; //(decodeImage picks the .ktx2 files baked with the same flip)
+	}
+	bool getFlipVertically() const { return flipVertically; }
+
+	//cache key: canonical absolute path + flags
+	string key(const string& path, bool gamma, bool normalMap = false) const {
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(path, error), error);
+		string name = error ? path : canonical.generic_string();
+		name += gamma ? "|srgb" : "|linear";
+		if (normalMap) name += "|normal";
+		name += flipVertically ? "|flip" : "|noflip";
+		return name;
+	}
+
+	//look up a texture and add a reference on a hit. returns false (and counts a miss) if it isn't cached.
+	bool acquire(const string& path, bool gamma, bool normalMap, unsigned int& textureID) {
+		auto entry = entries.find(key(path, gamma, normalMap));
+		if (entry == entries.end()) {
+			stats.misses++;
+			return false;
+		}
+		entry->second.refCount++;
+		stats.hits++;
+		textureID = entry->second.id;
+		return true;
+	}
+
+	//register a texture that was uploaded after a miss (starts with one reference) and return the id to use.
+	//if the key got an entry meanwhile (another spelling of the same file), the cached texture gets the reference
+	//and the duplicate is deleted: its id must not be used after this
+	unsigned int insert(const string& path, bool gamma, bool normalMap, unsigned int textureID) {
+		string name = key(path, gamma, normalMap);
+		auto cached = entries.find(name);
+		if (cached != entries.end()) {
+			cached->second.refCount++;
+			destroy(textureID);
+			return cached->second.id;
+		}
+		Entry& entry = entries[name];
+		entry.id = textureID;
+		entry.refCount = 1;
+		keys[textureID] = name;
+		return textureID;
+	}
+
+	//load a texture through the cache (decodes and uploads on this thread on a miss)
+	//normalMap: its mips are renormalized (textureLoadOptions().cpuMips)
+	unsigned int load(const string& path, bool gamma = false, bool normalMap = false) {
+		unsigned int textureID;
+		if (acquire(path, gamma, normalMap, textureID)) return textureID;
+
+		DecodedImage image = decodeImage(path, 0, (gamma ? MIP_SRGB : 0) | (normalMap ? MIP_NORMAL_MAP : 0));
+		return insert(path, gamma, normalMap, uploadTexture(image, gamma));
+	}
+
+	//load a texture through the cache without waiting for it: a miss returns a texture that streams in over the next frames
+	//(TextureStreamer::update() once per frame)
+	unsigned int stream(const string& path, bool gamma = false, bool normalMap = false) {
+		unsigned int textureID;
+		if (acquire(path, gamma, normalMap, textureID)) return textureID;
+
+		return insert(path, gamma, normalMap, TextureStreamer::instance().request(path, gamma, normalMap));
+	}
+
+	//drop a reference, the texture object is deleted with the last one
+	void release(unsigned int textureID) {
+		auto name = keys.find(textureID);
+		if (name == keys.end()) return;
+		auto entry = entries.find(name->second);
+		if (--entry->second.refCount > 0) return;
+
+		destroy(textureID);
+		entries.erase(entry);
+		keys.erase(name);
+	}
+
+	Stats getStats() const {
+		Stats current = stats;
+		current.resident = entries.size();
+		return current;
+	}
+
+	void printStats() const {
+		Stats current = getStats();
+		std::cout << "texture cache: " << current.hits << " hits, " << current.misses << " misses, "
+			<< current.resident << " resident" << std::endl;
+	}
+
+
+
+private:
+	struct Entry {
+		unsigned int id;
+		unsigned int refCount;
+	};
+
+	unordered_map<string, Entry> entries;   //key -> texture
+	unordered_map<unsigned int, string> keys; //texture -> key (for release by id)
+	Stats stats;
+	bool flipVertically;
+
+	//delete a texture object (and its stream, if it is still streaming in)
+	void destroy(unsigned int textureID) {
+		TextureStreamer::instance().cancel(textureID);
+		GLState::instance().textureDeleted(textureID);
+		glDeleteTextures(1, &textureID);
+	}
+
+	TextureCache() : flipVertically(false) {
+		stats.hits = stats.misses = stats.resident = 0;
+	}
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+};
+#endif // !TEXTURE_CACHE_H
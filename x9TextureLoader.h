@@ -0,0 +1,251 @@
+/*Texture decoding off the GL thread.
+* stbi_load() is pure CPU work (file read + png/jpg decompression), only the glTexImage2D upload needs the GL context.
+* So the decode runs on worker threads and the GL thread only uploads the images as they finish.
+* A .ktx2 file (BakeTexture) is read instead of decoded: its blocks and mips go to the GPU as they are (see KTX2.h).
+* With textureLoadOptions().preferKTX2, "wall.png" loads "wall.ktx2" if that exists and has the requested row order.
+* With textureLoadOptions().cpuMips the worker also computes the mip chain (see MipGenerator.h): the upload sends every level
+* and the GL thread never runs glGenerateMipmap.*/
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include "stb_image.h"
+#include "GLState.h"
+#include "KTX2.h"
+#include "MipGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <filesystem>
+using namespace std;
+
+//settings of decodeImage() (all threads)
+struct TextureLoadOptions {
+	bool flipVertically; //rows bottom to top, set by TextureCache::setFlipVertically (stb_image's flag can't be read back)
+	bool preferKTX2;     //look for a baked .ktx2 next to the png/jpg first
+	bool cpuMips;        //generate the mip levels in decodeImage(), false: glGenerateMipmap after the upload
+	Mip_Filter mipFilter;
+};
+inline TextureLoadOptions& textureLoadOptions() {
+	static TextureLoadOptions options = { false, true, true, MIP_KAISER };
+	return options;
+}
+
+//pixels of one image file, decoded but not uploaded yet
+struct DecodedImage {
+	string path;         //full file path (directory + '/' + file)
+	size_t tag;          //caller's id for the request (to match the result with the texture it belongs to)
+	int width, height, nrComponents;
+	unsigned char* data; //stbi_load result, nullptr if the decode failed
+	shared_ptr<KTX2Image> compressed; //read from a .ktx2 file instead (data stays nullptr)
+	vector<vector<unsigned char>> mips; //levels 1..n (cpuMips), level 0 is data
+};
+
+//the .ktx2 to read for a path: the path itself, or its baked sibling. empty: decode the path with stb_image
+//(a sibling older than the image is stale, the image was edited after the bake)
+inline string ktx2PathFor(const string& path) {
+	std::filesystem::path file(path);
+	if (file.extension() == ".ktx2") return path;
+	if (!textureLoadOptions().preferKTX2) return string();
+	std::error_code error;
+	std::filesystem::path baked = file;
+	baked.replace_extension(".ktx2");
+	if (!std::filesystem::exists(baked, error)) return string();
+	std::filesystem::file_time_type bakedTime = std::filesystem::last_write_time(baked, error);
+	if (error) return string();
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(file, error);
+	if (!error && sourceTime > bakedTime) return string();
+	return baked.string();
+}
+
+//true if the .ktx2 read for path can stand in for it: it is the path itself, or a sibling baked from this very file
+//(wall.png and wall.jpg share wall.ktx2) with the row order the loader uses now
+inline bool ktx2Matches(const string& path, const string& ktx2Path, const KTX2Image& image) {
+	if (ktx2Path == path) return true;
+	if (!image.source.empty() && image.source != std::filesystem::path(path).filename().string()) return false;
+	return image.flipped == textureLoadOptions().flipVertically;
+}
+
+//decode an image on the calling thread (can be any thread)
+//mipFlags: MIP_SRGB for textures uploaded with gamma, MIP_NORMAL_MAP for normal maps (only used with cpuMips)
+DecodedImage decodeImage(const string& path, size_t tag = 0, unsigned int mipFlags = 0) {
+	DecodedImage image;
+	image.path = path;
+	image.tag = tag;
+	image.width = image.height = image.nrComponents = 0;
+	image.data = nullptr;
+	string ktx2Path = ktx2PathFor(path);
+	if (!ktx2Path.empty()) {
+		shared_ptr<KTX2Image> compressed = make_shared<KTX2Image>();
+		if (readKTX2(ktx2Path, *compressed)) {
+			//a sibling baked from another file, or with the other row order (upside down): decode the original instead
+			if (ktx2Matches(path, ktx2Path, *compressed)) {
+				image.width = compressed->width;
+				image.height = compressed->height;
+				image.nrComponents = compressed->format == BLOCK_BC5 ? 2 : 4;
+				image.compressed = compressed;
+				return image;
+			}
+		}
+		if (ktx2Path == path) return image;
+	}
+	image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.nrComponents, 0);
+	if (image.data && textureLoadOptions().cpuMips)
+		generateMips(image.data, image.width, image.height, image.nrComponents, textureLoadOptions().mipFilter, mipFlags, image.mips);
+	return image;
+}
+
+//upload a decoded image into a new texture object and free its pixels (GL thread only)
+//gamma: the image is sRGB encoded -> let GL linearize it when sampling
+unsigned int uploadTexture(DecodedImage& image, bool gamma = false) {
+	if (image.compressed) {
+		unsigned int compressedID = uploadKTX2(*image.compressed, gamma);
+		image.compressed.reset();
+		return compressedID;
+	}
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+
+	if (image.data) {
+		GLenum format = GL_RGB;
+		if (image.nrComponents == 1) format = GL_RED;
+		else if (image.nrComponents == 3) format = GL_RGB;
+		else if (image.nrComponents == 4) format = GL_RGBA;
+		GLenum internalFormat = format;
+		if (gamma && format == GL_RGB) internalFormat = GL_SRGB;
+		else if (gamma && format == GL_RGBA) internalFormat = GL_SRGB_ALPHA;
+
+		GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+		if (image.mips.empty()) {
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		else {
+			//every level as generated (rows are tightly packed: a 1 texel wide RGB level has 3 byte rows)
+			GLint unpackAlignment = 4;
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+			int width = image.width, height = image.height;
+			for (size_t level = 0; level < image.mips.size(); level++) {
+				width = width > 1 ? width / 2 : 1;
+				height = height > 1 ? height / 2 : 1;
+				glTexImage2D(GL_TEXTURE_2D, (GLint)level + 1, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, image.mips[level].data());
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.mips.size());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+			image.mips.clear();
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else std::cout << "Texture failed to load at path: " << image.path << std::endl;
+
+	stbi_image_free(image.data);
+	image.data = nullptr;
+	return textureID;
+}
+
+
+
+//a fixed set of worker threads that run stbi_load() for submitted files.
+//finished images are queued in completion order, the GL thread pops them with waitNext() and uploads them.
+class TextureDecodePool
+{
+public:
+	//threadCount 0 -> defaultThreadCount()
+	TextureDecodePool(unsigned int threadCount = 0) : pending(0), stopping(false) {
+		if (threadCount == 0) threadCount = defaultThreadCount();
+		for (unsigned int i = 0; i < threadCount; i++) workers.emplace_back(&TextureDecodePool::workerLoop, this);
+	}
+
+	~TextureDecodePool() {
+		{
+			lock_guard<mutex> lock(queueMutex);
+			stopping = true;
+		}
+		requestReady.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+
+		//free images nobody picked up
+		for (unsigned int i = 0; i < finished.size(); i++) stbi_image_free(finished[i].data);
+	}
+
+	//queue a file for decoding (mipFlags: see decodeImage)
+	void submit(const string& path, size_t tag, unsigned int mipFlags = 0) {
+		{
+			lock_guard<mutex> lock(queueMutex);
+			requests.push_back(Request{ path, tag, mipFlags });
+			pending++;
+		}
+		requestReady.notify_one();
+	}
+
+	//block until the next image is decoded. returns false when every submitted file has been handed out.
+	bool waitNext(DecodedImage& out) {
+		unique_lock<mutex> lock(queueMutex);
+		if (pending == 0) return false;
+		imageReady.wait(lock, [this] { return !finished.empty(); });
+		out = std::move(finished.front()); //(no copy of the mip levels)
+		finished.pop_front();
+		pending--;
+		return true;
+	}
+
+	unsigned int threadCount() const { return (unsigned int)workers.size(); }
+	//one worker per hardware thread (what a pool created without a count gets, e.g. the one of Model::loadTextures)
+	static unsigned int defaultThreadCount() {
+		unsigned int count = std::thread::hardware_concurrency();
+		return count ? count : 4; //hardware_concurrency() may return 0 if unknown
+	}
+
+
+
+private:
+	vector<std::thread> workers;
+	struct Request {
+		string path;
+		size_t tag;
+		unsigned int mipFlags;
+	};
+	deque<Request> requests;              //files waiting for a worker
+	deque<DecodedImage> finished;         //decoded images waiting for the GL thread
+	size_t pending;                       //submitted but not yet handed out by waitNext()
+	bool stopping;
+	mutex queueMutex;
+	condition_variable requestReady;
+	condition_variable imageReady;
+
+	void workerLoop() {
+		while (true) {
+			Request request;
+			{
+				unique_lock<mutex> lock(queueMutex);
+				requestReady.wait(lock, [this] { return stopping || !requests.empty(); });
+				if (stopping) return;
+				request = requests.front();
+				requests.pop_front();
+			}
+
+			//the expensive part runs without holding the lock
+			DecodedImage image = decodeImage(request.path, request.tag, request.mipFlags);
+
+			{
+				lock_guard<mutex> lock(queueMutex);
+				finished.push_back(std::move(image));
+			}
+			imageReady.notify_one();
+		}
+	}
+};
+#endif // !TEXTURE_LOADER_H
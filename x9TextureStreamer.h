@@ -0,0 +1,412 @@
+/*Progressive texture streaming.
+* TextureCache::load decodes and uploads the whole texture before it returns, so a Model isn't done until every full size image is.
+* TextureStreamer::request() returns at once with a texture that can be sampled:
+*   - its storage is allocated for the whole chain (glTexStorage2D: immutable, GL 4.2 / ARB_texture_storage),
+*   - the small levels (MIP_TAIL_SIZE and below) are filled right away: read from a .ktx2 file (they come first in it),
+*     a png/jpg shows a flat placeholder texel until its decode is done (the format has no small levels to read first),
+*   - GL_TEXTURE_BASE_LEVEL points at the biggest level that is filled, so sampling never reads a level that isn't there.
+* The decode (stb_image + MipGenerator, or the rest of the .ktx2) runs on the streamer's worker threads.
+* update(), once per frame on the GL thread, uploads what they finished: the tail first, then the bigger levels smallest to
+* largest in bands of rows, until the frame's budget (MB) is spent. BASE_LEVEL moves down each time a level is complete.
+*   unsigned int texture = TextureStreamer::instance().request("wall.png", gamma);
+*   ...every frame: TextureStreamer::instance().update(8.0f);
+*   TextureStreamer::instance().residentLevel(texture);   0 once the full size level is in*/
+
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+#include "TextureLoader.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+const int MIP_TAIL_SIZE = 64; //levels up to this width and height are uploaded with the request (.ktx2) or the decode (png/jpg)
+
+class TextureStreamer
+{
+public:
+	//totals since start
+	struct Stats {
+		size_t requests;       //request() calls
+		size_t completed;      //textures with every level resident
+		size_t bytesUploaded;  //texel bytes sent by update()
+		size_t framesOverBudget; //update() calls that had to exceed the budget to make progress (a single row bigger than it)
+	};
+
+	//the one streamer of the process (its workers start with the first request)
+	static TextureStreamer& instance() {
+		static TextureStreamer streamer;
+		return streamer;
+	}
+
+	~TextureStreamer() {
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		requestReady.notify_all();
+		for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+	}
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	//a texture for an image file, usable immediately (GL thread). gamma: sRGB like uploadTexture's, normalMap: renormalized mips
+	unsigned int request(const std::string& path, bool gamma = false, bool normalMap = false) {
+		stats.requests++;
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+		StreamedTexture texture;
+		texture.generation = ++generations;
+		texture.path = path;
+		texture.mipFlags = (gamma ? MIP_SRGB : 0) | (normalMap ? MIP_NORMAL_MAP : 0);
+		if (!describe(path, gamma, texture)) {
+			std::cout << "Texture failed to load at path: " << path << std::endl;
+			return textureID;
+		}
+		allocate(textureID, texture);
+		uploadTail(textureID, texture);
+		textures[textureID] = texture;
+
+		startWorkers();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			Job job;
+			job.texture = textureID;
+			job.generation = texture.generation;
+			job.path = texture.ktx2 ? texture.ktx2Path : path;
+			job.ktx2 = texture.ktx2;
+			job.decodeBlocks = texture.ktx2 && !texture.compressed;
+			job.mipFlags = texture.mipFlags;
+			job.width = texture.width;
+			job.height = texture.height;
+			jobs.push_back(job);
+		}
+		requestReady.notify_one();
+		return textureID;
+	}
+
+	//upload finished decodes, at most budgetMB megabytes of texels (GL thread, once per frame). returns the bytes uploaded
+	size_t update(float budgetMB) {
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			while (!finished.empty()) {
+				Job& job = finished.front();
+				auto texture = textures.find(job.texture);
+				//(a job of a cancelled texture whose name the GL has handed out again: not ours)
+				if (texture != textures.end() && texture->second.generation != job.generation) texture = textures.end();
+				if (texture != textures.end() && texture->second.levelCount == (int)job.levels.size()) {
+					StreamedTexture& streamed = texture->second;
+					streamed.levels.swap(job.levels);
+					//(the resident level is only filled if it came from the file's tail, not the placeholder)
+					streamed.nextLevel = streamed.tailUploaded ? streamed.resident - 1 : streamed.levelCount - 1;
+					uploading.push_back(job.texture);
+				}
+				else if (texture != textures.end()) {
+					//(unreadable, or the file changed since request(): the placeholder stays)
+					std::cout << "(TextureStreamer.h)★ERROR::cannot stream " << texture->second.path << std::endl;
+					textures.erase(texture);
+				}
+				finished.pop_front();
+			}
+		}
+
+		size_t budget = (size_t)(std::max(budgetMB, 0.0f) * 1024.0f * 1024.0f), spent = 0;
+		while (!uploading.empty()) {
+			auto entry = textures.find(uploading.front());
+			if (entry == textures.end()) {
+				uploading.pop_front();
+				continue;
+			}
+			if (!uploadLevels(entry->first, entry->second, budget, spent)) break;
+			//every level is in: the decoded copy isn't needed anymore
+			textures.erase(entry);
+			uploading.pop_front();
+			stats.completed++;
+		}
+		stats.bytesUploaded += spent;
+		return spent;
+	}
+
+	//lowest (= biggest) mip level the texture can sample: 0 when complete. textures the streamer doesn't know are complete
+	int residentLevel(unsigned int texture) const {
+		auto entry = textures.find(texture);
+		return entry == textures.end() ? 0 : entry->second.resident;
+	}
+	//textures with levels still missing
+	size_t streamingCount() const { return textures.size(); }
+
+	//forget a texture that is about to be deleted (TextureCache::release): its pending decode is dropped.
+	//(a decode already running on a worker is dropped by update(): its generation doesn't match a later request of the same name)
+	void cancel(unsigned int texture) {
+		if (!textures.erase(texture)) return;
+		uploading.erase(std::remove(uploading.begin(), uploading.end(), texture), uploading.end());
+		std::lock_guard<std::mutex> lock(queueMutex);
+		auto sameTexture = [texture](const Job& job) { return job.texture == texture; };
+		jobs.erase(std::remove_if(jobs.begin(), jobs.end(), sameTexture), jobs.end());
+		finished.erase(std::remove_if(finished.begin(), finished.end(), sameTexture), finished.end());
+	}
+
+	Stats getStats() const { return stats; }
+	void printStats() const {
+		std::cout << "texture streamer: " << stats.requests << " requests, " << stats.completed << " complete, " << textures.size() << " streaming, "
+			<< stats.bytesUploaded / (1024.0 * 1024.0) << " MB uploaded, " << stats.framesOverBudget << " frames over budget" << std::endl;
+	}
+
+
+
+private:
+	struct StreamedTexture {
+		unsigned int generation; //request() number: tells this texture's job from one of a deleted texture with the same name
+		std::string path, ktx2Path;
+		bool ktx2;          //levels read from a .ktx2 file
+		bool compressed;    //the GL samples its block format (false: decoded to RGBA8)
+		Block_Format blockFormat;
+		GLenum internalFormat, format; //format: of the uncompressed texel data
+		int components;     //bytes per uncompressed texel
+		int width, height, levelCount;
+		unsigned int mipFlags;
+		int resident;       //GL_TEXTURE_BASE_LEVEL
+		bool tailUploaded;  //the levels from resident down are real texels (false: a placeholder)
+		std::vector<std::vector<unsigned char>> levels; //the worker's result
+		int nextLevel, nextRow; //upload position: level, rows of it already sent
+		StreamedTexture() : generation(0), ktx2(false), compressed(false), blockFormat(BLOCK_BC1), internalFormat(0), format(0), components(4),
+			width(0), height(0), levelCount(0), mipFlags(0), resident(0), tailUploaded(false), nextLevel(0), nextRow(0) {}
+	};
+	struct Job {
+		unsigned int texture, generation;
+		std::string path;
+		bool ktx2, decodeBlocks;
+		unsigned int mipFlags;
+		int width, height; //as request() saw them
+		std::vector<std::vector<unsigned char>> levels; //result (empty: failed)
+	};
+
+	std::unordered_map<unsigned int, StreamedTexture> textures; //texture -> state, until every level is resident
+	std::deque<unsigned int> uploading;  //decoded textures in upload order
+	unsigned int generations;            //request() calls so far
+	Stats stats;
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs, finished;
+	bool stopping;
+	std::mutex queueMutex;
+	std::condition_variable requestReady;
+
+	TextureStreamer() : generations(0), stopping(false) { stats = Stats{ 0, 0, 0, 0 }; }
+
+	void startWorkers() {
+		if (!workers.empty()) return;
+		//(fewer than the decode pool: streaming runs while frames are being drawn)
+		unsigned int threadCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+		for (unsigned int i = 0; i < threadCount; i++) workers.emplace_back(&TextureStreamer::workerLoop, this);
+	}
+
+	static int levelSize(int size, int level) { return std::max(size >> level, 1); }
+
+	//size and format from the file header (a .ktx2 sibling baked from this file with the right row order, like decodeImage)
+	bool describe(const std::string& path, bool gamma, StreamedTexture& texture) {
+		std::string ktx2Path = ktx2PathFor(path);
+		if (!ktx2Path.empty()) {
+			KTX2Image header;
+			if (readKTX2(ktx2Path, header, 0xFFFFFFFFu) && ktx2Matches(path, ktx2Path, header)) {
+				texture.ktx2 = true;
+				texture.ktx2Path = ktx2Path;
+				texture.blockFormat = header.format;
+				texture.width = header.width;
+				texture.height = header.height;
+				texture.levelCount = (int)header.levels.size();
+				bool srgb = gamma && header.format != BLOCK_BC5;
+				GLenum blockFormat = ktx2GLFormat(header.format, srgb);
+				texture.compressed = blockFormat && compressedFormatSupported(header.format, srgb);
+				texture.internalFormat = texture.compressed ? blockFormat : (header.format == BLOCK_BC5 ? GL_RG8 : (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8));
+				texture.format = GL_RGBA;
+				texture.components = 4;
+				return true;
+			}
+			if (ktx2Path == path) return false;
+		}
+		int components = 0;
+		if (!stbi_info(path.c_str(), &texture.width, &texture.height, &components) || components < 1 || components > 4) return false;
+		const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		const GLenum linearFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		texture.components = components;
+		texture.format = formats[components - 1];
+		texture.internalFormat = gamma && components == 3 ? GL_SRGB8 : gamma && components == 4 ? GL_SRGB8_ALPHA8 : linearFormats[components - 1];
+		texture.levelCount = mipLevelCount(texture.width, texture.height); //(the workers always generate the mips: the chain is what streams)
+		return true;
+	}
+
+	//storage for every level, sampling limited to the last one for now
+	void allocate(unsigned int textureID, StreamedTexture& texture) {
+		GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+		bool immutable = false;
+#if defined(GL_VERSION_4_2) || defined(GL_ARB_texture_storage)
+		bool storage = false;
+#ifdef GL_VERSION_4_2
+		storage = GLAD_GL_VERSION_4_2;
+#endif
+#ifdef GL_ARB_texture_storage
+		storage = storage || GLAD_GL_ARB_texture_storage;
+#endif
+		if (storage) {
+			glTexStorage2D(GL_TEXTURE_2D, texture.levelCount, texture.internalFormat, texture.width, texture.height);
+			immutable = true;
+		}
+#endif
+		//(without it: every level specified empty, the same complete texture but resizable)
+		for (int level = 0; !immutable && level < texture.levelCount; level++) {
+			int width = levelSize(texture.width, level), height = levelSize(texture.height, level);
+			if (texture.compressed)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, width, height, 0, (GLsizei)compressedSize(texture.blockFormat, width, height), NULL);
+			else glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, width, height, 0, texture.format, GL_UNSIGNED_BYTE, NULL);
+		}
+		texture.resident = texture.levelCount - 1;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.resident);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	//what can be shown before the worker is done: the .ktx2's small levels, or one flat texel in the last level
+	void uploadTail(unsigned int textureID, StreamedTexture& texture) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (texture.ktx2) {
+			int first = texture.levelCount - 1;
+			while (first > 0 && levelSize(texture.width, first - 1) <= MIP_TAIL_SIZE && levelSize(texture.height, first - 1) <= MIP_TAIL_SIZE) first--;
+			KTX2Image tail;
+			if (levelSize(texture.width, first) <= MIP_TAIL_SIZE && levelSize(texture.height, first) <= MIP_TAIL_SIZE
+				&& readKTX2(texture.ktx2Path, tail, (uint32_t)first)) {
+				for (int level = texture.levelCount - 1; level >= first; level--) {
+					int width = levelSize(texture.width, level), height = levelSize(texture.height, level);
+					std::vector<unsigned char> rgba;
+					const unsigned char* data = tail.levels[level].data();
+					if (!texture.compressed) {
+						rgba.resize((size_t)width * height * 4);
+						decompressImage(texture.blockFormat, data, width, height, rgba.data());
+						data = rgba.data();
+					}
+					uploadRows(texture, level, 0, height, data);
+				}
+				setResident(textureID, texture, first);
+				texture.tailUploaded = true;
+			}
+		}
+		else {
+			//mid gray (normal maps: straight up), opaque
+			unsigned char texel[4] = { 128, 128, 128, 255 };
+			if (texture.mipFlags & MIP_NORMAL_MAP) texel[2] = 255;
+			uploadRows(texture, texture.levelCount - 1, 0, 1, texel);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	//rows [firstRow, firstRow + rowCount) of a level (block formats: multiples of 4 rows, or up to the last row)
+	void uploadRows(const StreamedTexture& texture, int level, int firstRow, int rowCount, const unsigned char* levelData) {
+		int width = levelSize(texture.width, level);
+		if (texture.compressed) {
+			size_t rowBytes = compressedSize(texture.blockFormat, width, 4);
+			const unsigned char* data = levelData + rowBytes * (firstRow / 4);
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, firstRow, width, rowCount, texture.internalFormat,
+				(GLsizei)compressedSize(texture.blockFormat, width, rowCount), data);
+		}
+		else glTexSubImage2D(GL_TEXTURE_2D, level, 0, firstRow, width, rowCount, texture.format, GL_UNSIGNED_BYTE,
+			levelData + (size_t)firstRow * width * texture.components);
+	}
+
+	void setResident(unsigned int textureID, StreamedTexture& texture, int level) {
+		texture.resident = level;
+		GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	}
+
+	//continue the decoded texture's upload within the budget. true when every level is resident
+	bool uploadLevels(unsigned int textureID, StreamedTexture& texture, size_t budget, size_t& spent) {
+		GLState::instance().bindTexture(GL_TEXTURE_2D, textureID);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		bool done = true;
+		for (; texture.nextLevel >= 0; texture.nextLevel--) {
+			int level = texture.nextLevel;
+			int width = levelSize(texture.width, level), height = levelSize(texture.height, level);
+			bool tail = width <= MIP_TAIL_SIZE && height <= MIP_TAIL_SIZE;
+			int rowStep = texture.compressed ? 4 : 1;
+			size_t rowBytes = texture.compressed ? compressedSize(texture.blockFormat, width, 4) : (size_t)width * texture.components;
+			//rows that fit in what is left of the budget (the tail always goes as a whole)
+			int rows = height - texture.nextRow;
+			if (!tail) {
+				size_t affordable = spent < budget ? (budget - spent) / rowBytes * rowStep : 0;
+				if (affordable == 0 && spent == 0) {
+					affordable = rowStep; //one row bigger than the whole budget: still move on
+					stats.framesOverBudget++;
+				}
+				if ((size_t)rows > affordable) rows = (int)affordable;
+			}
+			if (rows <= 0) {
+				done = false;
+				break;
+			}
+			uploadRows(texture, level, texture.nextRow, rows, texture.levels[level].data());
+			spent += rowBytes * ((rows + rowStep - 1) / rowStep);
+			texture.nextRow += rows;
+			if (texture.nextRow < height) {
+				done = false;
+				break;
+			}
+			texture.nextRow = 0;
+			if (level < texture.resident || !texture.tailUploaded) setResident(textureID, texture, level);
+			texture.tailUploaded = true;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return done;
+	}
+
+	void workerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				requestReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+				if (stopping) return;
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			if (job.ktx2) {
+				KTX2Image image;
+				if (readKTX2(job.path, image) && image.width == job.width && image.height == job.height) {
+					job.levels.swap(image.levels);
+					//the GL can't sample the blocks: RGBA8 levels instead
+					for (size_t level = 0; job.decodeBlocks && level < job.levels.size(); level++) {
+						int width = levelSize(image.width, (int)level), height = levelSize(image.height, (int)level);
+						std::vector<unsigned char> rgba((size_t)width * height * 4);
+						decompressImage(image.format, job.levels[level].data(), width, height, rgba.data());
+						job.levels[level].swap(rgba);
+					}
+				}
+			}
+			else {
+				int width, height, components;
+				unsigned char* data = stbi_load(job.path.c_str(), &width, &height, &components, 0);
+				if (data && width == job.width && height == job.height) {
+					std::vector<std::vector<unsigned char>> mips;
+					generateMips(data, width, height, components, textureLoadOptions().mipFilter, job.mipFlags, mips);
+					job.levels.push_back(std::vector<unsigned char>(data, data + (size_t)width * height * components));
+					for (size_t i = 0; i < mips.size(); i++) job.levels.push_back(std::move(mips[i]));
+				}
+				stbi_image_free(data);
+			}
+
+			std::lock_guard<std::mutex> lock(queueMutex);
+			finished.push_back(std::move(job));
+		}
+	}
+};
+#endif // !TEXTURE_STREAMER_H
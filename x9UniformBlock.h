@@ -0,0 +1,134 @@
+/*Uniform blocks (std140) shared by every program.
+* Camera, light and material values are the same for all the programs of a frame, but plain uniforms belong to one program:
+* each program needs its own glUniform* calls, one per value, every frame.
+* A uniform block lives in a buffer instead: the program only names a binding point (Shader::bindBlock),
+* and everything bound there is read by every program that uses the block.
+*   UniformBlocks blocks;
+*   unsigned int camera = blocks.add<CameraBlock>(CAMERA_BLOCK_BINDING);    (before the first update())
+*   blocks.get<CameraBlock>(camera).view = ...;
+*   blocks.update();                                                         once per frame, before the draws
+* All the blocks are in one buffer, so update() writes them with a single copy and binds their ranges.
+* The buffer is a StreamBuffer holding StreamBuffer::FRAME_COUNT copies (persistently mapped with GL 4.4 / ARB_buffer_storage):
+* the copy of frame n is written while the GPU may still read those of frame n-1, n-2 (a fence per copy makes sure it doesn't).
+* shader side (GLSL 410 has no layout(binding), the binding point is set from the program: Shader::bindBlock):
+*   layout (std140) uniform Camera { mat4 projection; mat4 view; vec3 viewPos; };
+* The structs below mirror the std140 layout: a vec3 takes 16 bytes, so each one is followed by a float
+* (which std140 puts in the same 16 bytes).*/
+
+#ifndef UNIFORM_BLOCK_H
+#define UNIFORM_BLOCK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <memory>
+
+#include "StreamBuffer.h"
+
+//binding points of the shared blocks
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHT_BLOCK_BINDING = 1;
+const GLuint MATERIAL_BLOCK_BINDING = 2;
+const GLuint OBJECT_BLOCK_BINDING = 3;
+
+//layout (std140) uniform Camera { mat4 projection; mat4 view; vec3 viewPos; };
+struct CameraBlock {
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec3 viewPos; float padding;
+};
+
+//layout (std140) uniform Light {
+//	vec3 position; float constant; vec3 direction; float linear; vec3 ambient; float quadratic;
+//	vec3 diffuse; float cutOff; vec3 specular; float outerCutOff; } light;
+struct LightBlock {
+	glm::vec3 position;  float constant;
+	glm::vec3 direction; float linear;
+	glm::vec3 ambient;   float quadratic;
+	glm::vec3 diffuse;   float cutOff;      //cosines of the spotlight angles
+	glm::vec3 specular;  float outerCutOff;
+};
+
+//layout (std140) uniform Material { vec3 ambient; float shininess; vec3 diffuse; vec3 specular; } material;
+struct MaterialBlock {
+	glm::vec3 ambient;  float shininess;
+	glm::vec3 diffuse;  float padding0;
+	glm::vec3 specular; float padding1;
+};
+
+//per draw instead of per frame: written into a StreamBuffer and bound by range before each draw
+//layout (std140) uniform Object { mat4 model; };
+struct ObjectBlock {
+	glm::mat4 model;
+};
+
+class UniformBlocks
+{
+public:
+	bool persistent; //the buffer is mapped once (GL 4.4 / ARB_buffer_storage), false: glBufferSubData
+
+	UniformBlocks() : persistent(false), frameSize(0), alignment(256) {
+		GLint offsetAlignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+		if (offsetAlignment > 0) alignment = (size_t)offsetAlignment;
+	}
+	UniformBlocks(const UniformBlocks&) = delete;
+	UniformBlocks& operator=(const UniformBlocks&) = delete;
+
+	//reserve a block of type T at a binding point (all the blocks are added before the first update()). returns its index
+	template <typename T>
+	unsigned int add(GLuint binding) {
+		if (stream) {
+			std::cout << "(UniformBlock.h)★ERROR::blocks must be added before the first update()" << std::endl;
+			return 0;
+		}
+		Block block;
+		block.binding = binding;
+		block.offset = frameSize;
+		block.size = sizeof(T);
+		blocks.push_back(block);
+		//every block starts at a multiple of the offset alignment (glBindBufferRange needs it)
+		frameSize = (frameSize + sizeof(T) + alignment - 1) / alignment * alignment;
+		staging.resize(frameSize, 0);
+		return (unsigned int)blocks.size() - 1;
+	}
+
+	//the CPU copy of a block: change it freely, update() sends it
+	template <typename T>
+	T& get(unsigned int block) { return *(T*)&staging[blocks[block].offset]; }
+
+	//one write of every block, then bind each at its binding point
+	void update() {
+		if (blocks.empty()) return;
+		if (!stream) {
+			stream.reset(new StreamBuffer(frameSize, GL_UNIFORM_BUFFER));
+			persistent = stream->persistent;
+		}
+		//the draws since the last update() read the previous copy: fence it, move on to the next one
+		else stream->endFrame();
+		stream->beginFrame();
+		GLintptr base = 0;
+		unsigned char* copy = (unsigned char*)stream->allocate(frameSize, alignment, base);
+		memcpy(copy, staging.data(), frameSize);
+		stream->flush();
+		for (size_t i = 0; i < blocks.size(); i++)
+			stream->bindRange(GL_UNIFORM_BUFFER, blocks[i].binding, base + blocks[i].offset, blocks[i].size);
+	}
+
+	//the buffer behind the blocks (its counters), nullptr before the first update()
+	const StreamBuffer* buffer() const { return stream.get(); }
+
+private:
+	struct Block {
+		GLuint binding;
+		size_t offset, size; //inside one frame's copy
+	};
+	std::vector<Block> blocks;
+	std::vector<unsigned char> staging; //the blocks of the frame being written
+	std::unique_ptr<StreamBuffer> stream; //FRAME_COUNT copies of every block
+	size_t frameSize;                   //one copy of every block, a multiple of alignment
+	size_t alignment;                   //GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+};
+#endif // !UNIFORM_BLOCK_H
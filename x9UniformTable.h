@@ -0,0 +1,116 @@
+/*Uniform reflection for a linked program.
+* glGetUniformLocation is a string lookup inside the driver, and the setXXX(name, ...) functions used to do it
+* for every uniform on every call, every frame.
+* After linking, the active uniforms are enumerated once into a flat open-addressing hash table (name -> location).
+* The string setters look names up here (no GL call, no allocation),
+* and hot loops can resolve a UniformHandle once and skip the lookup completely.*/
+
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+//resolved uniform of one program (location -1 = not active, glUniform* ignores it like GL does)
+struct UniformHandle {
+	GLint location;
+};
+
+class UniformTable
+{
+public:
+	UniformTable() : count(0) {}
+
+	//enumerate the active uniforms of a linked program
+	void build(GLuint program) {
+		slots.clear();
+		names.clear();
+		count = 0;
+
+		GLint active = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+		//array uniforms are reported once ("lights[0]"), every element gets its own entry + the bare name
+		std::vector<std::string> entries;
+		std::vector<char> name(maxLength + 1);
+		for (GLint i = 0; i < active; i++) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type;
+			glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+			std::string uniformName(&name[0], length);
+			if (uniformName.compare(0, 3, "gl_") == 0) continue; //built-ins have no location
+
+			entries.push_back(uniformName);
+			size_t bracket = uniformName.rfind("[0]");
+			if (bracket != std::string::npos && bracket + 3 == uniformName.size()) {
+				std::string base = uniformName.substr(0, bracket);
+				entries.push_back(base);
+				for (GLint element = 1; element < size; element++) entries.push_back(base + "[" + std::to_string(element) + "]");
+			}
+		}
+
+		//power of two capacity, at most half full
+		size_t capacity = 16;
+		while (capacity < entries.size() * 2) capacity *= 2;
+		slots.assign(capacity, Slot());
+		for (size_t i = 0; i < entries.size(); i++)
+			insert(entries[i].c_str(), glGetUniformLocation(program, entries[i].c_str()));
+	}
+
+	//location of a uniform, -1 if the program has no such active uniform
+	GLint find(const char* name) const {
+		if (slots.empty()) return -1;
+		uint64_t hash = hashName(name);
+		size_t mask = slots.size() - 1;
+		for (size_t i = (size_t)hash & mask; ; i = (i + 1) & mask) {
+			const Slot& slot = slots[i];
+			if (slot.nameOffset == EMPTY) return -1;
+			if (slot.hash == hash && strcmp(&names[slot.nameOffset], name) == 0) return slot.location;
+		}
+	}
+	GLint find(const std::string& name) const { return find(name.c_str()); }
+
+	unsigned int size() const { return count; }
+
+
+
+private:
+	static const uint32_t EMPTY = 0xFFFFFFFFu;
+	struct Slot {
+		uint64_t hash;
+		uint32_t nameOffset; //into names (EMPTY = free slot)
+		GLint location;
+		Slot() : hash(0), nameOffset(EMPTY), location(-1) {}
+	};
+
+	std::vector<Slot> slots;
+	std::vector<char> names; //all names, '\0' separated
+	unsigned int count;
+
+	static uint64_t hashName(const char* name) {
+		uint64_t hash = 14695981039346656037ull;
+		for (; *name; name++) hash = (hash ^ (unsigned char)*name) * 1099511628211ull;
+		return hash;
+	}
+
+	void insert(const char* name, GLint location) {
+		uint64_t hash = hashName(name);
+		size_t mask = slots.size() - 1;
+		size_t i = (size_t)hash & mask;
+		while (slots[i].nameOffset != EMPTY) {
+			if (slots[i].hash == hash && strcmp(&names[slots[i].nameOffset], name) == 0) return;
+			i = (i + 1) & mask;
+		}
+		slots[i].hash = hash;
+		slots[i].nameOffset = (uint32_t)names.size();
+		slots[i].location = location;
+		names.insert(names.end(), name, name + strlen(name) + 1);
+		count++;
+	}
+};
+#endif // !UNIFORM_TABLE_H
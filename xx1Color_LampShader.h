@@ -3,6 +3,9 @@
 #define LAMPSHADER_H
 
 #include <glad/glad.h>
+#include "UniformTable.h"
+#include "ProgramCache.h"
+#include "GLState.h"
 #include <iostream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,6 +15,7 @@ class LampShader
 {
 public:
 	unsigned int ID;
+	UniformTable uniforms; //name -> location of the active uniforms
 
 	LampShader() {
 		const char* vertexShaderCode = "#version 410 core\n"
@@ -29,72 +33,120 @@ public:
 			"void main() {"
 			"	FragColor = vec4(1.0);" //set all 4 vector values to 1.0
 			"}\0";
-		//☆2. compile shaders
-		unsigned int vertexShader, fragmentShader;
+		//a cached binary of the same sources skips the compile and link (see ProgramCache.h)
+		ID = ProgramCache::instance().load(vertexShaderCode, fragmentShaderCode);
+		if (!ID) {
+			//☆2. compile shaders
+			unsigned int vertexShader, fragmentShader;
 
-		//vertex Shader
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
-		glCompileShader(vertexShader);
-		checkCompileError(vertexShader, "VERTEX");
-		//fragment Shader
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		checkCompileError(fragmentShader, "FRAGMENT");
+			//vertex Shader
+			vertexShader = glCreateShader(GL_VERTEX_SHADER);
+			glShaderSource(vertexShader, 1, &vertexShaderCode, NULL);
+			glCompileShader(vertexShader);
+			checkCompileError(vertexShader, "VERTEX");
+			//fragment Shader
+			fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(fragmentShader, 1, &fragmentShaderCode, NULL);
+			glCompileShader(fragmentShader);
+			checkCompileError(fragmentShader, "FRAGMENT");
 
-		//shader Program 
-		ID = glCreateProgram();
-		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
-		glLinkProgram(ID);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+			//shader Program 
+			ID = glCreateProgram();
+			glAttachShader(ID, vertexShader);
+			glAttachShader(ID, fragmentShader);
+			ProgramCache::instance().link(ID, vertexShaderCode, fragmentShaderCode); //links, and keeps the binary for the next launch
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+		}
+		uniforms.build(ID); //reflect the active uniforms once, the setters look them up here
 	}
 
 	//use/activate the shader
 	void use()//activates the shader program
 	{
-		glUseProgram(ID);
+		GLState::instance().useProgram(ID); //skipped if the program is already in use
 	}
 
 	void setBool(const std::string& name, bool value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		glUniform1i(uniforms.find(name), (int)value);
 	}
 	void setInt(const std::string& name, int value) const {
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1i(uniforms.find(name), value);
 	}
 	void setFloat(const std::string& name, float value) const {
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		glUniform1f(uniforms.find(name), value);
 	}
 
 	void setVec2(const std::string& name, const glm::vec2& value) const {
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform2fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec2(const std::string& name, float x, float y) const {
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2f(uniforms.find(name), x, y);
 	}
 	void setVec3(const std::string& name, const glm::vec3& value) const {
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform3fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec3(const std::string& name, float x, float y, float z) const {
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(uniforms.find(name), x, y, z);
 	}
 	void setVec4(const std::string& name, const glm::vec4& value) const {
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		glUniform4fv(uniforms.find(name), 1, &value[0]);
 	}
 	void setVec4(const std::string& name, float x, float y, float z, float w) {
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(uniforms.find(name), x, y, z, w);
 	}
 
 	void setMat2(const std::string& name, const glm::mat2& mat) const {
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix2fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	void setMat3(const std::string& name, const glm::mat3& mat) const {
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix3fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
 	}
 	void setMat4(const std::string& name, const glm::mat4& mat) const {
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		glUniformMatrix4fv(uniforms.find(name), 1, GL_FALSE, &mat[0][0]);
+	}
+
+	//resolve a uniform once (e.g. before a render loop) and pass the handle to the setters below
+	UniformHandle uniform(const std::string& name) const {
+		UniformHandle handle;
+		handle.location = uniforms.find(name);
+		return handle;
+	}
+	void setBool(UniformHandle uniform, bool value) const {
+		glUniform1i(uniform.location, (int)value);
+	}
+	void setInt(UniformHandle uniform, int value) const {
+		glUniform1i(uniform.location, value);
+	}
+	void setFloat(UniformHandle uniform, float value) const {
+		glUniform1f(uniform.location, value);
+	}
+	void setVec2(UniformHandle uniform, const glm::vec2& value) const {
+		glUniform2fv(uniform.location, 1, &value[0]);
+	}
+	void setVec2(UniformHandle uniform, float x, float y) const {
+		glUniform2f(uniform.location, x, y);
+	}
+	void setVec3(UniformHandle uniform, const glm::vec3& value) const {
+		glUniform3fv(uniform.location, 1, &value[0]);
+	}
+	void setVec3(UniformHandle uniform, float x, float y, float z) const {
+		glUniform3f(uniform.location, x, y, z);
+	}
+	void setVec4(UniformHandle uniform, const glm::vec4& value) const {
+		glUniform4fv(uniform.location, 1, &value[0]);
+	}
+	void setVec4(UniformHandle uniform, float x, float y, float z, float w) {
+		glUniform4f(uniform.location, x, y, z, w);
+	}
+	void setMat2(UniformHandle uniform, const glm::mat2& mat) const {
+		glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat3(UniformHandle uniform, const glm::mat3& mat) const {
+		glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat4(UniformHandle uniform, const glm::mat4& mat) const {
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
 	}
 
 
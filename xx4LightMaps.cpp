@@ -4,7 +4,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #define STB_IMAGE_IMPLEMENTATION
-#include "std_image.h"
+#include "stb_image.h"
+#include "TextureCache.h"
+#include "GLState.h"
 #include "Shader.h"
 #include "LightShader.h"
 #include "Camera.h"
@@ -164,7 +166,7 @@ int main() {
 	glGenBuffers(1, &VBO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	glBindVertexArray(cubeVAO);
+	GLState::instance().bindVertexArray(cubeVAO);
 	// position attribute
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
@@ -179,7 +181,7 @@ int main() {
 	//(VBO stays the same: the vertices are the same for the light object which is also a 3D cube)
 	unsigned lightVAO;
 	glGenVertexArrays(1, &lightVAO);
-	glBindVertexArray(lightVAO);
+	GLState::instance().bindVertexArray(lightVAO);
 	//The only need to do is binding to the VBO, (to link it with glVertexAttribPointer)
 	//the container's VBO's data already contains the exact data
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -198,53 +200,10 @@ int main() {
 
 
 	//load and create textures
-	unsigned int texture1, texture2;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h flip loaded texture's on the y-axis.
-
-	int width, height, nrChannels;
-	// The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with my own image path.	
-	unsigned char* data = stbi_load("bg6.jpg", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture1" << std::endl;
-	}
-	stbi_image_free(data);
-
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	data = stbi_load("Alpha.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "★Failed to load texture2" << std::endl;
-	}
-	stbi_image_free(data);
+	//(the textures are shared through the process-wide TextureCache: a file is decoded and uploaded only once)
+	TextureCache::instance().setFlipVertically(true); // tell stb_image.h flip loaded texture's on the y-axis.
+	unsigned int texture1 = TextureCache::instance().load("bg6.jpg");
+	unsigned int texture2 = TextureCache::instance().load("Alpha.png");
 
 	//activate shader & set the shader's uniform attributes
 	myShader.use();
@@ -272,10 +231,8 @@ int main() {
 		//└also clear the depth buffer(otherwise the depth infomation of the precious frame stays in the buffer)
 
 		// bind Texture
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
+		GLState::instance().bindTextureUnit(0, texture1);
+		GLState::instance().bindTextureUnit(1, texture2);
 
 		//★activate shader & setting unifroms
 		myShader.use();
@@ -327,7 +284,7 @@ int main() {
 		//glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
 
 		//★render the cube
-		glBindVertexArray(cubeVAO);
+		GLState::instance().bindVertexArray(cubeVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 
 
@@ -347,7 +304,7 @@ int main() {
 		model = glm::scale(model, glm::vec3(0.5f)); // a smaller cube
 		lampShader.setMat4("model", model);
 
-		glBindVertexArray(lightVAO);
+		GLState::instance().bindVertexArray(lightVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
 
 
@@ -360,9 +317,14 @@ int main() {
 
 
 	//optional - de-allocate all resource once they've outlived their purpose
+	GLState::instance().vertexArrayDeleted(cubeVAO);
+	GLState::instance().vertexArrayDeleted(lightVAO);
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lightVAO);
 	glDeleteBuffers(1, &VBO);
+	TextureCache::instance().release(texture1);
+	TextureCache::instance().release(texture2);
+	TextureCache::instance().printStats();
 	//glfw: terminate, clearing all previously allocatedd GLFW resources
 	glfwTerminate();
 	return 0;
@@ -0,0 +1,13 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (std140) uniform Camera { //shared by every program (UniformBlock.h: CameraBlock)
+	mat4 projection;
+	mat4 view;
+	vec3 viewPos;
+};
+layout (std140) uniform Object { //per draw (UniformBlock.h: ObjectBlock, written into a StreamBuffer)
+	mat4 model;
+};
+void main(){
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
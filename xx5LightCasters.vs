@@ -1,11 +1,24 @@
-		const char* vertexShaderCode = "#version 410 core\n"
-			"layout (location = 0) in vec3 aPos;"
-			"layout (location = 1) in vec2 aTexCoord;"
-			"layout (location = 2) in vec3 aNormal;"
-			"out vec2 TexCoord;"
-			"out vec3 FragPos;"
-			"out vec3 Normal;"
-			"uniform mat4 model;"
-			"uniform mat4 view;"
-			"uniform mat4 projection;"
-			"void main(){"
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in mat4 aInstanceModel; //per-instance model matrix (InstanceBuffer)
+out vec2 TexCoord;
+out vec3 FragPos;
+out vec3 Normal;
+layout (std140) uniform Object { //per draw (UniformBlock.h: ObjectBlock, written into a StreamBuffer)
+	mat4 model;
+};
+layout (std140) uniform Camera { //shared by every program (UniformBlock.h: CameraBlock)
+	mat4 projection;
+	mat4 view;
+	vec3 viewPos;
+};
+uniform bool instanced; //true: the model matrix comes from aInstanceModel (use it wherever model was used)
+void main(){
+	mat4 world = instanced ? aInstanceModel : model;
+	gl_Position = projection * view * world * vec4(aPos, 1.0);
+	TexCoord = aTexCoord;
+	FragPos = vec3(world * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(world))) * aNormal;
+}
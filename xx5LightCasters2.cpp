@@ -4,10 +4,12 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #define STB_IMAGE_IMPLEMENTATION
-#include "std_image.h"
+#include "stb_image.h"
+#include "TextureCache.h"
 #include "Shader.h"
 #include "LightShader.h"
 #include "Camera.h"
+#include "RenderContext.h"
 #include <iostream>
 #include <cmath>
 
@@ -68,37 +70,23 @@ void scroll_callback(GLFWwindow* window, double xOffset, double yOffset) {
 
 
 
-int main() {
-	//initialize and configue
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char** argv) {
+	//window, or an offscreen context with --headless (see RenderContext.h)
+	RenderContext renderContext(parseRenderOptions(argc, argv), 1600, 1200, "Xion's OpenGL");
+	if (!renderContext.ok()) return -1;
+	GLFWwindow* window = renderContext.window;
+	if (window) {
+		glfwSetFramebufferSizeCallback(window, window_size_change);
 
-	//glfw window creation
-	GLFWwindow* window = glfwCreateWindow(1600, 1200, "Xion's OpenGL", NULL, NULL);
-	if (window == NULL) {
-		std::cout << "★Failed to create window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, window_size_change);
-
-	//register this function with GLFW each time the mouse moves
-	glfwSetCursorPosCallback(window, mouse_callback);
-
-	//to zoon in, use mouse's scroll wheel
-	glfwSetScrollCallback(window, scroll_callback);
+		//register this function with GLFW each time the mouse moves
+		glfwSetCursorPosCallback(window, mouse_callback);
 
-	//to calculate the yaw and pitch values from mouse movement.
-	//When the application has focus, the mouse cursor should be hiden and stays within the window
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		//to zoon in, use mouse's scroll wheel
+		glfwSetScrollCallback(window, scroll_callback);
 
-	//glad : load all OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+		//to calculate the yaw and pitch values from mouse movement.
+		//When the application has focus, the mouse cursor should be hiden and stays within the window
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	//configure global OpenGL state
@@ -211,73 +199,11 @@ int main() {
 
 
 	//load and create textures
-	unsigned int texture1, texture2 , emission;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h flip loaded texture's on the y-axis.
-
-	int width, height, nrChannels;
-	// The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with my own image path.	
-	unsigned char* data = stbi_load("container2.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture1" << std::endl;
-	}
-	stbi_image_free(data);
-
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	data = stbi_load("steel.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "★Failed to load texture2" << std::endl;
-	}
-	stbi_image_free(data);
-
-	glGenTextures(1, &emission);
-	glBindTexture(GL_TEXTURE_2D, emission);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	data = stbi_load("Alpha.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "★Failed to load emission" << std::endl;
-	}
-	stbi_image_free(data);
+	//(the textures are shared through the process-wide TextureCache: a file is decoded and uploaded only once)
+	TextureCache::instance().setFlipVertically(true); // tell stb_image.h flip loaded texture's on the y-axis.
+	unsigned int texture1 = TextureCache::instance().load("container2.png");
+	unsigned int texture2 = TextureCache::instance().load("steel.png");
+	unsigned int emission = TextureCache::instance().load("Alpha.png");
 
 	//activate shader & set the shader's uniform attributes
 	myShader.use();
@@ -293,14 +219,14 @@ int main() {
 
 	//------------------------------------------------------
 	//render loop
-	while (!glfwWindowShouldClose(window))
+	while (renderContext.running())
 	{
 		//per-frame time logic
-		deltaTime = (float)glfwGetTime() - lastFrame;
-		lastFrame = (float)glfwGetTime();
+		deltaTime = (float)renderContext.time() - lastFrame;
+		lastFrame = (float)renderContext.time();
 
 		//input
-		user_input(window);
+		if (window) user_input(window);
 
 		//render
 		glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
@@ -341,7 +267,7 @@ int main() {
 
 		//★world transformation
 		glm::mat4 model = glm::mat4(1.0f);
-		float angle = (float)glfwGetTime() * 80.0f + 5.0f;
+		float angle = (float)renderContext.time() * 80.0f + 5.0f;
 		model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0, 0.8f, 0.6f));
 
 		myShader.setMat4("model", model);
@@ -355,7 +281,7 @@ int main() {
 		{
 			glm::mat4 model = glm::mat4(1.0f);
 			model = glm::translate(model, cubePositions[i]);
-			//float spin = (float)glfwGetTime() * 80.0f + 5.0f + (i * 20.0f);
+			//float spin = (float)renderContext.time() * 80.0f + 5.0f + (i * 20.0f);
 			//if(!i%2) model = glm::rotate(model, glm::radians(spin), glm::vec3(1.0, (float)i / 10, 0.5f));
 			float angle = 20.0f * i;
 			//model = glm::rotate(model, glm::radians(spin), glm::vec3((float)i/10 * 2, 1.0, 0.3f));
@@ -387,8 +313,8 @@ int main() {
 
 
 		//glfw : swap buffer and poll event (key pressed/release, mouse moved etc..)
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		//(headless: wait for the frame and record its time)
+		renderContext.endFrame();
 		
 	}
 
@@ -398,7 +324,11 @@ int main() {
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lightVAO);
 	glDeleteBuffers(1, &VBO);
+	TextureCache::instance().release(texture1);
+	TextureCache::instance().release(texture2);
+	TextureCache::instance().release(emission);
+	TextureCache::instance().printStats();
 	//glfw: terminate, clearing all previously allocatedd GLFW resources
-	glfwTerminate();
+	//(done by ~RenderContext)
 	return 0;
 }
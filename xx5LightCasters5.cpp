@@ -4,16 +4,25 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #define STB_IMAGE_IMPLEMENTATION
-#include "std_image.h"
+#include "stb_image.h"
+#include "TextureCache.h"
+#include "InstanceBuffer.h"
+#include "Frustum.h"
+#include "GLState.h"
 #include "Shader.h"
-#include "LightShader.h"
+#include "UniformBlock.h"
 #include "Camera.h"
+#include "RenderContext.h"
+#include "Profiler.h"
 #include <iostream>
 #include <cmath>
 
 const unsigned int SCR_WIDTH = 1600;
 const unsigned int SCR_HEIGHT = 1200;
 
+//true: the cube field is one glDrawArraysInstanced, false: one Object block range + glDrawArrays per cube
+const bool INSTANCED_CUBES = true;
+
 //camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
@@ -68,45 +77,57 @@ void scroll_callback(GLFWwindow* window, double xOffset, double yOffset) {
 
 
 
-int main() {
-	//initialize and configue
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	//glfw window creation
-	GLFWwindow* window = glfwCreateWindow(1600, 1200, "Xion's OpenGL", NULL, NULL);
-	if (window == NULL) {
-		std::cout << "★Failed to create window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, window_size_change);
+int main(int argc, char** argv) {
+	//window, or an offscreen context with --headless (see RenderContext.h)
+	RenderOptions options = parseRenderOptions(argc, argv);
+	RenderContext renderContext(options, 1600, 1200, "Xion's OpenGL");
+	if (!renderContext.ok()) return -1;
+	//--profile <file.csv|file.json>: time the regions below (see Profiler.h)
+	Profiler::instance().enabled = !options.profile.empty();
+	GLFWwindow* window = renderContext.window;
+	if (window) {
+		glfwSetFramebufferSizeCallback(window, window_size_change);
 
-	//register this function with GLFW each time the mouse moves
-	//glfwSetCursorPosCallback(window, mouse_callback);
+		//register this function with GLFW each time the mouse moves
+		//glfwSetCursorPosCallback(window, mouse_callback);
 
-	//to zoon in, use mouse's scroll wheel
-	glfwSetScrollCallback(window, scroll_callback);
+		//to zoon in, use mouse's scroll wheel
+		glfwSetScrollCallback(window, scroll_callback);
 
-	//to calculate the yaw and pitch values from mouse movement.
-	//When the application has focus, the mouse cursor should be hiden and stays within the window
-	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	//glad : load all OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+		//to calculate the yaw and pitch values from mouse movement.
+		//When the application has focus, the mouse cursor should be hiden and stays within the window
+		//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	}
 
 	//configure global OpenGL state
 	glEnable(GL_DEPTH_TEST);
 
 	//shader program
-	Shader myShader = Shader();
-	LightShader lampShader = LightShader();
+	//(GLSL files, edits are picked up while the demo runs: see Shader::reload)
+	Shader myShader("xx5LightCasters.vs", "xx5LightCasters5.fs");
+	Shader lampShader("xx5Lamp.vs", "xx5Lamp.fs");
+
+	//camera, light and material values in uniform blocks shared by both programs:
+	//one buffer write per frame instead of a glUniform* call per value and program (see UniformBlock.h)
+	UniformBlocks blocks;
+	unsigned int cameraBlock = blocks.add<CameraBlock>(CAMERA_BLOCK_BINDING);
+	unsigned int lightBlock = blocks.add<LightBlock>(LIGHT_BLOCK_BINDING);
+	unsigned int materialBlock = blocks.add<MaterialBlock>(MATERIAL_BLOCK_BINDING);
+	//what changes per draw (model matrices, the instance matrices of the cube field) is written linearly into
+	//this frame's region of a persistently mapped buffer and bound by offset: no glUniform*, no upload (see StreamBuffer.h)
+	StreamBuffer frameData(64 * 1024);
+	GLint objectAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &objectAlignment);
+	//one model matrix in the Object block, bound at OBJECT_BLOCK_BINDING for the next draw
+	auto bindModel = [&](const glm::mat4& model) {
+		GLintptr offset = 0;
+		ObjectBlock* object = frameData.allocate<ObjectBlock>(offset, (size_t)objectAlignment);
+		if (!object) return false;
+		object->model = model;
+		frameData.flush();
+		frameData.bindRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, offset, sizeof(ObjectBlock));
+		return true;
+	};
 
 	//set up vertex data(and buffer) and configure vertex attributes
 	float vertices[] = {
@@ -177,7 +198,7 @@ int main() {
 	glGenBuffers(1, &VBO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-	glBindVertexArray(cubeVAO);
+	GLState::instance().bindVertexArray(cubeVAO);
 	// position attribute
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
@@ -187,12 +208,26 @@ int main() {
 	// normal attribute
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * (sizeof(float)), (void*)(5 * sizeof(float)));
 	glEnableVertexAttribArray(2);
+	// per-instance model matrix attribute (the matrices of the cubes in view, streamed every frame through frameData)
+	InstanceBuffer cubeInstances;
+	cubeInstances.attach();
+	glm::mat4 cubeTransforms[10];
+	for (unsigned int i = 0; i < 10; i++) {
+		float angle = 20.0f * i;
+		cubeTransforms[i] = glm::rotate(glm::translate(glm::mat4(1.0f), cubePositions[i]), glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+	}
+	//bounding spheres for the frustum culling (a unit cube fits in a sphere of radius sqrt(3)/2)
+	CullBounds cubeBounds;
+	for (unsigned int i = 0; i < 10; i++) cubeBounds.addSphere(cubePositions[i], 0.8660254f);
+	unsigned char cubeVisible[10];
+	glm::mat4 visibleTransforms[10];
+	size_t visibleCubes = 0;
 
 	//★Configure the light's VAO
 	//(VBO stays the same: the vertices are the same for the light object which is also a 3D cube)
 	unsigned lightVAO;
 	glGenVertexArrays(1, &lightVAO);
-	glBindVertexArray(lightVAO);
+	GLState::instance().bindVertexArray(lightVAO);
 	//The only need to do is binding to the VBO, (to link it with glVertexAttribPointer)
 	//the container's VBO's data already contains the exact data
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -211,83 +246,38 @@ int main() {
 
 
 	//load and create textures
-	unsigned int texture1, texture2 , emission;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
-	// set the texture wrapping parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// set texture filtering parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	// load image, create texture and generate mipmaps
-
-	stbi_set_flip_vertically_on_load(true); // tell stb_image.h flip loaded texture's on the y-axis.
-
-	int width, height, nrChannels;
-	// The FileSystem::getPath(...) is part of the GitHub repository so we can find files on any IDE/platform; replace it with my own image path.	
-	unsigned char* data = stbi_load("container2.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "Failed to load texture1" << std::endl;
-	}
-	stbi_image_free(data);
-
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	data = stbi_load("steel.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "★Failed to load texture2" << std::endl;
-	}
-	stbi_image_free(data);
-
-	glGenTextures(1, &emission);
-	glBindTexture(GL_TEXTURE_2D, emission);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	data = stbi_load("Alpha.png", &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		//glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		std::cout << "★Failed to load emission" << std::endl;
-	}
-	stbi_image_free(data);
+	//(the textures are shared through the process-wide TextureCache: a file is decoded and uploaded only once)
+	TextureCache::instance().setFlipVertically(true); // tell stb_image.h flip loaded texture's on the y-axis.
+	unsigned int loadRegion = Profiler::instance().begin("load textures");
+	unsigned int texture1 = TextureCache::instance().load("container2.png");
+	unsigned int texture2 = TextureCache::instance().load("steel.png");
+	unsigned int emission = TextureCache::instance().load("Alpha.png");
+	Profiler::instance().end(loadRegion);
 
 	//activate shader & set the shader's uniform attributes
-	myShader.use();
-	myShader.setInt("texture1", 0);
-	myShader.setInt("texture2", 1);
-	myShader.setInt("emission", 2);
-	myShader.setVec3("lightPos", lightPosition);
-	myShader.setVec3("light.position", camera.Position);
-	myShader.setVec3("light.direction", camera.Front);
-	myShader.setFloat("light.cutOff", glm::cos(glm::radians(12.5f)));
+	//(again after every reload: a relinked program starts with all of its uniforms at 0)
+	auto setupShader = [&]() {
+		myShader.use();
+		myShader.setInt("texture1", 0);
+		myShader.setInt("texture2", 1);
+		myShader.setInt("emission", 2);
+		myShader.setVec3("lightPos", lightPosition);
+		myShader.setBool("instanced", INSTANCED_CUBES);
+
+		myShader.bindBlock("Camera", CAMERA_BLOCK_BINDING);
+		myShader.bindBlock("Light", LIGHT_BLOCK_BINDING);
+		myShader.bindBlock("Material", MATERIAL_BLOCK_BINDING);
+		myShader.bindBlock("Object", OBJECT_BLOCK_BINDING);
+		lampShader.bindBlock("Camera", CAMERA_BLOCK_BINDING);
+		lampShader.bindBlock("Object", OBJECT_BLOCK_BINDING);
+	};
+	setupShader();
+
+	//★light properties (the spotlight stays where the camera started)
+	LightBlock& light = blocks.get<LightBlock>(lightBlock);
+	light.position = camera.Position;
+	light.direction = camera.Front;
+	light.cutOff = glm::cos(glm::radians(12.5f));
 	/* Why we're not setting an angle for the cutoff value but the cosine result to the fragment shader?
 	* --< To compare directly an angle with a cosine value >
 	* since the fragment shader calculating the dot product between the LightDir and the SpotDir vector 
@@ -297,87 +287,105 @@ int main() {
 	* --> so to save some performance we calculate the cosine of a given cutoff angle 
 	* and pass this result to the fragment shader.
 	*/
-	myShader.setFloat("light.outerCutOff", glm::cos(glm::radians(17.5f)));
-	myShader.setVec3("viewPos", camera.Position);
+	light.outerCutOff = glm::cos(glm::radians(17.5f));
+	light.ambient = glm::vec3(.1f, .1f, .1f);
+	light.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+	light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	light.constant = 1.0f;
+	light.linear = 0.007f;
+	light.quadratic = 0.0002f;
+
+	//★material properties
+	MaterialBlock& material = blocks.get<MaterialBlock>(materialBlock);
+	material.ambient = glm::vec3(.2f, .2f, .2f);
+	material.diffuse = glm::vec3(.7f, .7f, .7f);
+	material.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	material.shininess = 32.0f;
 
 
 	//------------------------------------------------------
 	//render loop
-	while (!glfwWindowShouldClose(window))
+	while (renderContext.running())
 	{
 		//per-frame time logic
-		deltaTime = (float)glfwGetTime() - lastFrame;
-		lastFrame = (float)glfwGetTime();
+		deltaTime = (float)renderContext.time() - lastFrame;
+		lastFrame = (float)renderContext.time();
+		GLState::instance().beginFrame();
+		Profiler::instance().beginFrame();
+		//the next region of the per-draw data (only waits if the GPU is still drawing from it, frameData counts it)
+		frameData.beginFrame();
 
 		//input
-		user_input(window);
+		{
+			ProfileScope scope("input");
+			if (window) user_input(window);
+		}
+		//swap in the edited shader files
+		bool reloaded = myShader.reload();
+		if (lampShader.reload() || reloaded) setupShader();
 
 		//render
 		glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		//└also clear the depth buffer(otherwise the depth infomation of the precious frame stays in the buffer)
 
-		// bind Texture
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, emission);
+		// bind Texture (through the state cache: after the first frame these are all filtered out)
+		GLState::instance().bindTextureUnit(0, texture1);
+		GLState::instance().bindTextureUnit(1, texture2);
+		GLState::instance().bindTextureUnit(2, emission);
 
 		//★activate shader & setting unifroms
-		myShader.use();
-		myShader.setVec3("viewPos", camera.Position);
-
-		//★light properties 
-		myShader.setVec3("light.ambient", .1f, .1f, .1f);
-		myShader.setVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
-		myShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		myShader.setFloat("light.constant", 1.0f);
-		myShader.setFloat("light.linear", 0.007f);
-		myShader.setFloat("light.quadratic", 0.0002f);
-
-
-		//★material properties
-		myShader.setVec3("material.ambient", .2f, .2f, .2f);
-		myShader.setVec3("material.diffuse", .7f, .7f, .7f);
-		myShader.setVec3("material.specular", 1.0f, 1.0f, 1.0f);
-		myShader.setFloat("material.shininess", 32.0f);
-
+		unsigned int uniformRegion = Profiler::instance().begin("uniforms");
 		//★view/projection transformations
-		//pass projection matrix to shader(in this case it could change every frame)
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)4 / (float)3, .1f, 100.0f);
-		myShader.setMat4("projection", projection);
-
-		//camera/view transformation
-		glm::mat4 view = camera.GetViewMatrix();
-		myShader.setMat4("view", view);
+		//(projection could change every frame: the zoom)
+		CameraBlock& cameraValues = blocks.get<CameraBlock>(cameraBlock);
+		cameraValues.projection = glm::perspective(glm::radians(camera.Zoom), (float)4 / (float)3, .1f, 100.0f);
+		cameraValues.view = camera.GetViewMatrix();
+		cameraValues.viewPos = camera.Position;
+		const glm::mat4& projection = cameraValues.projection;
+		const glm::mat4& view = cameraValues.view;
+		//every block (camera, light, material) in one write, for both programs
+		blocks.update();
+		myShader.use();
 
 		//★world transformation
 		glm::mat4 model = glm::mat4(1.0f);
-		float angle = (float)glfwGetTime() * 80.0f + 5.0f;
+		float angle = (float)renderContext.time() * 80.0f + 5.0f;
 		model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0, 0.8f, 0.6f));
 
-		myShader.setMat4("model", model);
+		bindModel(model);
 		//↕
-		//unsigned int modelLocation = glGetUniformLocation(myShader.ID, "model");
-		//glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+		//myShader.setMat4("model", model);   (a uniform of this program only, sent by a glUniformMatrix4fv call)
+		Profiler::instance().end(uniformRegion);
 
 		//★render the cube
-		glBindVertexArray(cubeVAO);
-		for (unsigned int i = 0; i < 10; i++)
-		{
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			//float spin = (float)glfwGetTime() * 80.0f + 5.0f + (i * 20.0f);
-			//if(!i%2) model = glm::rotate(model, glm::radians(spin), glm::vec3(1.0, (float)i / 10, 0.5f));
-			float angle = 20.0f * i;
-			//model = glm::rotate(model, glm::radians(spin), glm::vec3((float)i/10 * 2, 1.0, 0.3f));
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			myShader.setMat4("model", model);
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		unsigned int cubeRegion = Profiler::instance().begin("cubes");
+		GLState::instance().bindVertexArray(cubeVAO);
+		//skip the cubes outside the camera's view
+		visibleCubes = cullSpheres(extractFrustum(projection * view), cubeBounds, cubeVisible);
+		if (INSTANCED_CUBES) {
+			unsigned int instanceCount = 0;
+			for (unsigned int i = 0; i < 10; i++) if (cubeVisible[i]) visibleTransforms[instanceCount++] = cubeTransforms[i];
+			cubeInstances.stream(frameData, visibleTransforms, instanceCount);
+			cubeInstances.draw(GL_TRIANGLES, 0, 36);
 		}
+		else {
+			for (unsigned int i = 0; i < 10; i++)
+			{
+				if (!cubeVisible[i]) continue;
+				glm::mat4 model = glm::mat4(1.0f);
+				model = glm::translate(model, cubePositions[i]);
+				//float spin = (float)renderContext.time() * 80.0f + 5.0f + (i * 20.0f);
+				//if(!i%2) model = glm::rotate(model, glm::radians(spin), glm::vec3(1.0, (float)i / 10, 0.5f));
+				float angle = 20.0f * i;
+				//model = glm::rotate(model, glm::radians(spin), glm::vec3((float)i/10 * 2, 1.0, 0.3f));
+				model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+				if (!bindModel(model)) break;
+
+				glDrawArrays(GL_TRIANGLES, 0, 36);
+			}
+		}
+		Profiler::instance().end(cubeRegion);
 
 
 
@@ -385,24 +393,30 @@ int main() {
 		//★draw the lamp object
 
 		//activate Lamp's Shader
+		unsigned int lampRegion = Profiler::instance().begin("lamp");
 		lampShader.use();
-		lampShader.setMat4("projection", projection);
-		lampShader.setMat4("view", view);
 
 		//translate the lamp cube to the light's position and scale it down
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPosition);
 		model = glm::scale(model, glm::vec3(0.5f)); // a smaller cube
-		lampShader.setMat4("model", model);
+		bindModel(model);
 
-		glBindVertexArray(lightVAO);
+		GLState::instance().bindVertexArray(lightVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
+		Profiler::instance().end(lampRegion);
+
 
 
+		//the draws above read this frame's region
+		frameData.endFrame();
 
 		//glfw : swap buffer and poll event (key pressed/release, mouse moved etc..)
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		//(headless: wait for the frame and record its time)
+		{
+			ProfileScope scope("swap");
+			renderContext.endFrame();
+		}
 		
 	}
 
@@ -412,7 +426,20 @@ int main() {
 	glDeleteVertexArrays(1, &cubeVAO);
 	glDeleteVertexArrays(1, &lightVAO);
 	glDeleteBuffers(1, &VBO);
+	TextureCache::instance().release(texture1);
+	TextureCache::instance().release(texture2);
+	TextureCache::instance().release(emission);
+	TextureCache::instance().printStats();
+	std::cout << "cubes: " << visibleCubes << " visible, " << 10 - visibleCubes << " culled last frame" << std::endl;
+	GLState::instance().printFrameStats();
+	frameData.printStats();
+	if (blocks.buffer()) blocks.buffer()->printStats();
+	Profiler::instance().finish();
+	if (!options.profile.empty()) {
+		Profiler::instance().printSummary();
+		Profiler::instance().write(options.profile);
+	}
 	//glfw: terminate, clearing all previously allocatedd GLFW resources
-	glfwTerminate();
+	//(done by ~RenderContext)
 	return 0;
 }